@@ -51,5 +51,7 @@ extern Model *modelCD4539;
 extern Model *modelCD4562;
 extern Model *modelCD40106;
 extern Model *modelMC14530;
+extern Model *modelSR1M;
 extern Model *modelTruth2;
 extern Model *modelTruth3;
+extern Model *modelTruthN;
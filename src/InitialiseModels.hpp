@@ -54,5 +54,7 @@ p->addModel(modelCD4539);
 p->addModel(modelCD4562);
 p->addModel(modelCD40106);
 p->addModel(modelMC14530);
+p->addModel(modelSR1M);
 p->addModel(modelTruth2);
 p->addModel(modelTruth3);
+p->addModel(modelTruthN);
@@ -3,48 +3,25 @@
 //	CMOS Input - Software model of a CMOS input
 //  Copyright (C) 2020  Adam Verspaget
 //----------------------------------------------------------------------------
+// thresholds used by any input that has not been given its module's thresholds
+static const CMOSThresholds standardThresholds;
+
 class CMOSInput {
 	private:
-		// supply voltage
-		float Vdd = VDD;
-		
-		// voltages for guaranteed high and low
-		float vLow = Vdd  / 3.0f;
-		float vHigh = Vdd / 1.5f;
-		
-		// threshold around which noise causes instability
-		float vThresh = Vdd / 2.0;
+		// thresholds shared by all inputs on the module
+		const CMOSThresholds *thresholds = &standardThresholds;
 		
 		// the current state of the input
 		bool currentState = true;
 		
-		int inputMode = VCVRACK_STANDARD;
 	public:
 
 		void reset() {
 			currentState = false;
 		}
 
-		void setMode(int mode) {
-			switch(mode) {
-				case CD40106_SCHMITT:
-					vLow = Vdd  * 0.38f; // approx 4.6V for Vdd = 12V
-					vHigh = Vdd  * 0.58f; // approx 7V for Vdd = 12V
-					inputMode = mode;
-					break;
-				case CMOS_NON_SCHMITT:
-				case CMOS_SCHMITT:
-					vLow = Vdd  * 0.3f;
-					vHigh = Vdd  * 0.7f;
-					inputMode = mode;
-					break;
-				case VCVRACK_STANDARD:
-				default:
-					vLow = 0.1f;
-					vHigh = 2.0f;
-					inputMode = VCVRACK_STANDARD;
-					break;
-			}
+		void setThresholds(const CMOSThresholds *t) {
+			thresholds = t;
 		}
 
 		bool process(float in) {
@@ -52,13 +29,13 @@ class CMOSInput {
 			// TODO: add different mode behaviours here
 			if (currentState) {
 				// HIGH to LOW
-				if (in <= vLow) {
+				if (in <= thresholds->vLow) {
 					currentState = false;
 				}
 			}
 			else {
 				// LOW to HIGH
-				if (in >= vHigh) {
+				if (in >= thresholds->vHigh) {
 					currentState = true;
 				}
 			}
@@ -70,3 +47,100 @@ class CMOSInput {
 			return currentState;
 		}
 };
+
+
+// up to 16 inputs modelled together, 4 at a time with SIMD. The voltages are given as a contiguous array
+// padded out to a multiple of 4 and the states come back as a single word with the first input in bit 0.
+#define CMOS_INPUT_BANK_MAX 16
+
+class CMOSInputBank {
+	private:
+		// thresholds shared by all inputs on the module
+		const CMOSThresholds *thresholds = &standardThresholds;
+		
+		int numInputs = 0;
+		int numGroups = 0;
+		
+		// the current state of each input as a SIMD mask
+		simd::float_4 currentState[CMOS_INPUT_BANK_MAX / 4];
+		
+	public:
+	
+		CMOSInputBank(int n = CMOS_INPUT_BANK_MAX) {
+			numInputs = std::min(n, CMOS_INPUT_BANK_MAX);
+			numGroups = (numInputs + 3) / 4;
+			reset();
+		}
+		
+		void reset() {
+			for (int g = 0; g < CMOS_INPUT_BANK_MAX / 4; g++)
+				currentState[g] = simd::float_4::zero();
+		}
+
+		void setThresholds(const CMOSThresholds *t) {
+			thresholds = t;
+		}
+
+		int process(const float *in) {
+			simd::float_4 vLow = thresholds->vLow;
+			simd::float_4 vHigh = thresholds->vHigh;
+			
+			int bits = 0;
+			for (int g = 0; g < numGroups; g++) {
+				simd::float_4 v = simd::float_4::load(&in[g * 4]);
+				
+				// high inputs stay high until they fall to the low threshold, low ones wait for the high threshold
+				currentState[g] = simd::ifelse(currentState[g], v > vLow, v >= vHigh);
+				bits |= simd::movemask(currentState[g]) << (g * 4);
+			}
+			
+			return bits & ((1 << numInputs) - 1);
+		}
+		
+		int size() {
+			return numInputs;
+		}
+};
+
+// every channel of a polyphonic input modelled together, 4 channels at a time with SIMD. The states come back
+// as a single word with the first channel in bit 0 so storage for all channels can be handled with bitwise ops.
+class CMOSPolyInput {
+	private:
+		// thresholds shared by all inputs on the module
+		const CMOSThresholds *thresholds = &standardThresholds;
+		
+		// the current state of each channel as a SIMD mask
+		simd::float_4 currentState[PORT_MAX_CHANNELS / 4];
+		
+	public:
+	
+		CMOSPolyInput() {
+			reset();
+		}
+		
+		void reset() {
+			for (int g = 0; g < PORT_MAX_CHANNELS / 4; g++)
+				currentState[g] = simd::float_4::zero();
+		}
+
+		void setThresholds(const CMOSThresholds *t) {
+			thresholds = t;
+		}
+
+		// a monophonic input is copied to all of the given channels
+		int process(Input &input, int channels) {
+			simd::float_4 vLow = thresholds->vLow;
+			simd::float_4 vHigh = thresholds->vHigh;
+			
+			int bits = 0;
+			for (int c = 0; c < channels; c += 4) {
+				simd::float_4 v = input.getPolyVoltageSimd<simd::float_4>(c);
+				
+				// high inputs stay high until they fall to the low threshold, low ones wait for the high threshold
+				currentState[c >> 2] = simd::ifelse(currentState[c >> 2], v > vLow, v >= vHigh);
+				bits |= simd::movemask(currentState[c >> 2]) << c;
+			}
+			
+			return bits & ((1 << channels) - 1);
+		}
+};
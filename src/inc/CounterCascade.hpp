@@ -0,0 +1,89 @@
+//----------------------------------------------------------------------------
+//	Lunetta Modula Plugin for VCV Rack by Count Modula
+//	Counter Cascade - lets adjacent binary counters count as one wide counter
+//  Copyright (C) 2026  Adam Verspaget
+//----------------------------------------------------------------------------
+#pragma once
+
+#include "ExpanderCascade.hpp"
+
+#define CASCADE_MAX_BITS 64
+
+// base for the binary counters that can be set to cascade with the counter on their left to form a counter
+// of up to 64 stages. The head of the cascade does all of the counting and writes each following counter's
+// slice of the count straight to its outputs in the same sample, so there's no carry delay between them.
+// The following counters do nothing at all of their own while they're being driven.
+struct CascadableCounter : Module {
+	// number of stages this counter adds to the cascade and the ids of the first stage's output and light
+	int numStages = 0;
+	int firstOutput = 0;
+	int firstLight = 0;
+
+	// the count as it stands - the whole cascade's count at the head, just this counter's stages in any
+	// that follow
+	uint64_t count = 0;
+
+	// where we sit in the cascade, worked out when a neighbour or the cascade option changes
+	CascadeState cascade;
+
+	// the count as last written to the outputs, -1 forces them all to be rewritten
+	int64_t prevCount = -1;
+
+	// gate voltage for this counter's outputs
+	virtual float getGateVoltage() = 0;
+
+	// write the given count to this counter's outputs. Only the outputs whose bits have flipped need
+	// writing - usually just one or two per clock and none at all when there's been no clock.
+	void setCount(uint64_t newCount, bool force) {
+		uint64_t changed = (force ? ~(uint64_t)0 : newCount ^ prevCount) & stageMask(numStages);
+		prevCount = newCount;
+
+		float gate = getGateVoltage();
+		while (changed) {
+			int b = __builtin_ctzll(changed);
+			changed &= changed - 1;
+
+			bool q = (newCount >> b) & 1;
+			outputs[firstOutput + b].setVoltage(q ? gate : 0.0f);
+			lights[firstLight + b].setBrightness(boolToLight(q));
+		}
+	}
+
+	static CascadableCounter *fromModule(Module *m) {
+		if (m && (m->model == modelCD4020 || m->model == modelCD4024 || m->model == modelCD4040))
+			return static_cast<CascadableCounter*>(m);
+
+		return NULL;
+	}
+
+	static CascadeState *cascadeOf(Module *m) {
+		CascadableCounter *c = fromModule(m);
+		return c ? &c->cascade : NULL;
+	}
+
+	void onExpanderChange(const ExpanderChangeEvent &e) override {
+		updateCascade(this, cascadeOf, CASCADE_MAX_BITS);
+	}
+
+	// true when we're being driven by the head of a cascade, in which case there's nothing for us to do
+	bool isCascaded() {
+		if (cascade.changed)
+			updateCascade(this, cascadeOf, CASCADE_MAX_BITS);
+
+		return cascade.offset > 0;
+	}
+
+	// hand each of the following counters its slice of the count
+	void driveCascade() {
+		int offset = numStages;
+		for (CascadableCounter *c = fromModule(rightExpander.module); c && c->cascade.offset == offset; c = fromModule(c->rightExpander.module)) {
+			c->count = (count >> offset) & stageMask(c->numStages);
+			c->setCount(c->count, false);
+			offset += c->numStages;
+		}
+	}
+
+	static uint64_t stageMask(int stages) {
+		return stages >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << stages) - 1;
+	}
+};
\ No newline at end of file
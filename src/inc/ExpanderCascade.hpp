@@ -0,0 +1,60 @@
+//----------------------------------------------------------------------------
+//	Lunetta Modula Plugin for VCV Rack by Count Modula
+//	Expander Cascade - lets adjacent modules of the same kind work as one wider part
+//  Copyright (C) 2026  Adam Verspaget
+//----------------------------------------------------------------------------
+#pragma once
+
+// cascade details kept by each module that can join the cascade of the module on its left. Joining is
+// optional and saved with the module so that modules placed side by side stay independent by default.
+struct CascadeState {
+	// saved option - join the cascade of the module on our left
+	bool enabled = false;
+
+	// set when the option changes so the cascade is worked out again on the next sample
+	bool changed = true;
+
+	// number of units (stages, bits or modules) we add to a cascade
+	int units = 1;
+
+	// position of our first unit in the cascade, 0 meaning we're at the head and do all the work
+	int offset = 0;
+
+	// total number of units in the cascade, only used at the head
+	int length = 1;
+};
+
+// work out the cascades across the whole run of adjacent modules that the given module belongs to. This is
+// only needed when a neighbour or one of the options changes, never per sample. cascadeOf() returns the
+// cascade details of a module that can be cascaded with this one or NULL for anything else. A module that
+// would take a cascade past maxUnits heads a new cascade of its own.
+inline void updateCascade(Module *m, CascadeState *(*cascadeOf)(Module*), int maxUnits) {
+	while (m->leftExpander.module && cascadeOf(m->leftExpander.module))
+		m = m->leftExpander.module;
+
+	CascadeState *head = NULL;
+	int offset = 0;
+	for (; m && cascadeOf(m); m = m->rightExpander.module) {
+		CascadeState *c = cascadeOf(m);
+		c->changed = false;
+
+		if (!head || !c->enabled || offset + c->units > maxUnits) {
+			head = c;
+			offset = 0;
+		}
+
+		c->offset = offset;
+		offset += c->units;
+		head->length = offset;
+	}
+}
+
+// context menu option for joining the cascade
+struct CascadeMenuItem : MenuItem {
+	CascadeState *cascade;
+
+	void onAction(const event::Action &e) override {
+		cascade->enabled ^= true;
+		cascade->changed = true;
+	}
+};
@@ -0,0 +1,253 @@
+//----------------------------------------------------------------------------
+//	Lunetta Modula Plugin for VCV Rack by Count Modula
+//	Logic Oversampler - runs a module's logic at 2x, 4x or 8x the engine rate
+//  Copyright (C) 2026  Adam Verspaget
+//----------------------------------------------------------------------------
+#pragma once
+
+#define OVERSAMPLING_MAX 8
+#define OVERSAMPLING_MAX_STAGES 3
+
+// non-zero even taps of a 15 tap Blackman windowed sinc half-band filter. The filter is symmetrical so
+// only the first half is given, the centre tap is 0.5 and the remaining odd taps are all zero.
+static const float HALF_BAND_COEFFS[4] = { -0.00066477706f, 0.010948410f, -0.058824774f, 0.29854114f };
+
+//----------------------------------------------------------------------------
+//	8 sample history for 4 SIMD lanes, doubled up so the taps can always be read without wrapping
+//----------------------------------------------------------------------------
+struct HalfBandHistory {
+	float buffer[64] = {};
+	int pos = 0;
+
+	void reset() {
+		for (int i = 0; i < 64; i++)
+			buffer[i] = 0.0f;
+
+		pos = 0;
+	}
+
+	void push(simd::float_4 x) {
+		pos = (pos + 7) & 7;
+		x.store(&buffer[pos << 2]);
+		x.store(&buffer[(pos + 8) << 2]);
+	}
+
+	// value pushed t samples ago
+	simd::float_4 tap(int t) {
+		return simd::float_4::load(&buffer[(pos + t) << 2]);
+	}
+
+	// symmetrical FIR of the even half-band taps across the whole history
+	simd::float_4 fir() {
+		return HALF_BAND_COEFFS[0] * (tap(0) + tap(7)) +
+			HALF_BAND_COEFFS[1] * (tap(1) + tap(6)) +
+			HALF_BAND_COEFFS[2] * (tap(2) + tap(5)) +
+			HALF_BAND_COEFFS[3] * (tap(3) + tap(4));
+	}
+};
+
+//----------------------------------------------------------------------------
+//	polyphase 2x half-band interpolator - one input sample in, two out
+//----------------------------------------------------------------------------
+struct HalfBandUpsampler {
+	HalfBandHistory history;
+
+	void reset() {
+		history.reset();
+	}
+
+	void process(simd::float_4 in, simd::float_4 *out) {
+		history.push(in);
+
+		// even phase is the filtered history, odd phase falls on the centre tap
+		out[0] = 2.0f * history.fir();
+		out[1] = history.tap(3);
+	}
+};
+
+//----------------------------------------------------------------------------
+//	polyphase 2x half-band decimator - two input samples in, one out
+//----------------------------------------------------------------------------
+struct HalfBandDecimator {
+	HalfBandHistory evenHistory;
+	HalfBandHistory oddHistory;
+
+	void reset() {
+		evenHistory.reset();
+		oddHistory.reset();
+	}
+
+	simd::float_4 process(simd::float_4 *in) {
+		evenHistory.push(in[0]);
+		oddHistory.push(in[1]);
+
+		return 0.5f * evenHistory.tap(3) + oddHistory.fir();
+	}
+};
+
+//----------------------------------------------------------------------------
+//	Oversampler for all inputs and outputs of a module. Port voltages are packed channel major so the
+//	first channel of every port sits side by side, meaning mono modules filter four ports per SIMD
+//	operation and polyphonic ones only pay for the channels actually in use.
+//----------------------------------------------------------------------------
+struct LogicOversampler {
+	int factor = 1;
+	int stages = 0;
+
+	int numInputs = 0;
+	int numOutputs = 0;
+
+	// number of slots (ports rounded up to a multiple of 4) in each channel row
+	int inputStride = 0;
+	int outputStride = 0;
+
+	// highest channel count seen on the inputs/outputs in the current sample
+	int inputChannels = 0;
+	int outputChannels = 0;
+
+	// oversampled voltages for each slot laid out as [sample][channel][port]
+	std::vector<float> inputSamples;
+	std::vector<float> outputSamples;
+
+	// engine supplied input voltages, restored once the logic has run
+	std::vector<float> savedInputs;
+
+	// filter states for each group of 4 slots in each stage
+	std::vector<HalfBandUpsampler> upsamplers;
+	std::vector<HalfBandDecimator> decimators;
+
+	LogicOversampler(int nInputs, int nOutputs) {
+		numInputs = nInputs;
+		numOutputs = nOutputs;
+
+		inputStride = (numInputs + 3) & ~3;
+		outputStride = (numOutputs + 3) & ~3;
+
+		inputSamples.resize(OVERSAMPLING_MAX * PORT_MAX_CHANNELS * inputStride);
+		outputSamples.resize(OVERSAMPLING_MAX * PORT_MAX_CHANNELS * outputStride);
+		savedInputs.resize(PORT_MAX_CHANNELS * inputStride);
+
+		upsamplers.resize(OVERSAMPLING_MAX_STAGES * PORT_MAX_CHANNELS * inputStride / 4);
+		decimators.resize(OVERSAMPLING_MAX_STAGES * PORT_MAX_CHANNELS * outputStride / 4);
+	}
+
+	void setFactor(int n) {
+		switch (n) {
+			case 2:
+				stages = 1;
+				break;
+			case 4:
+				stages = 2;
+				break;
+			case 8:
+				stages = 3;
+				break;
+			default:
+				n = 1;
+				stages = 0;
+				break;
+		}
+
+		factor = n;
+		reset();
+	}
+
+	void reset() {
+		for (HalfBandUpsampler &u : upsamplers)
+			u.reset();
+
+		for (HalfBandDecimator &d : decimators)
+			d.reset();
+	}
+
+	// grab the engine rate input voltages and interpolate them up to the oversampled rate
+	void upsample(Module *module) {
+		int inputRow = PORT_MAX_CHANNELS * inputStride;
+
+		inputChannels = 1;
+		for (int i = 0; i < numInputs; i++)
+			inputChannels = std::max(inputChannels, module->inputs[i].getChannels());
+
+		for (int c = 0; c < inputChannels; c++) {
+			for (int i = 0; i < numInputs; i++) {
+				float v = module->inputs[i].getVoltage(c);
+				savedInputs[c * inputStride + i] = v;
+				inputSamples[c * inputStride + i] = v;
+			}
+		}
+
+		// each stage doubles the number of samples - the samples to be interpolated are taken out of
+		// the buffer first so the results can be written back in place
+		int groups = inputChannels * inputStride / 4;
+		for (int stage = 0, n = 1; stage < stages; stage++, n <<= 1) {
+			HalfBandUpsampler *u = &upsamplers[stage * PORT_MAX_CHANNELS * inputStride / 4];
+			for (int g = 0; g < groups; g++) {
+				simd::float_4 in[OVERSAMPLING_MAX / 2];
+				for (int s = 0; s < n; s++)
+					in[s] = simd::float_4::load(&inputSamples[s * inputRow + g * 4]);
+
+				for (int s = 0; s < n; s++) {
+					simd::float_4 out[2];
+					u[g].process(in[s], out);
+					out[0].store(&inputSamples[(2 * s) * inputRow + g * 4]);
+					out[1].store(&inputSamples[(2 * s + 1) * inputRow + g * 4]);
+				}
+			}
+		}
+	}
+
+	// present the given oversampled input voltages to the module's logic
+	void loadInputs(Module *module, int s) {
+		float *samples = &inputSamples[s * PORT_MAX_CHANNELS * inputStride];
+		for (int c = 0; c < inputChannels; c++) {
+			for (int i = 0; i < numInputs; i++)
+				module->inputs[i].setVoltage(samples[c * inputStride + i], c);
+		}
+	}
+
+	// capture the output voltages produced by the module's logic for the given oversampled sample
+	void storeOutputs(Module *module, int s) {
+		if (s == 0) {
+			outputChannels = 1;
+			for (int o = 0; o < numOutputs; o++)
+				outputChannels = std::max(outputChannels, module->outputs[o].getChannels());
+		}
+
+		float *samples = &outputSamples[s * PORT_MAX_CHANNELS * outputStride];
+		for (int c = 0; c < outputChannels; c++) {
+			for (int o = 0; o < numOutputs; o++)
+				samples[c * outputStride + o] = module->outputs[o].getVoltage(c);
+		}
+	}
+
+	// filter the oversampled outputs back down to the engine rate and restore the engine's input voltages
+	void decimate(Module *module) {
+		int outputRow = PORT_MAX_CHANNELS * outputStride;
+		int groups = outputChannels * outputStride / 4;
+
+		// each stage halves the number of samples, working forwards so the results never overwrite unread samples
+		for (int stage = 0, n = factor >> 1; stage < stages; stage++, n >>= 1) {
+			HalfBandDecimator *d = &decimators[stage * PORT_MAX_CHANNELS * outputStride / 4];
+			for (int g = 0; g < groups; g++) {
+				for (int s = 0; s < n; s++) {
+					simd::float_4 in[2];
+					in[0] = simd::float_4::load(&outputSamples[(2 * s) * outputRow + g * 4]);
+					in[1] = simd::float_4::load(&outputSamples[(2 * s + 1) * outputRow + g * 4]);
+					d[g].process(in).store(&outputSamples[s * outputRow + g * 4]);
+				}
+			}
+		}
+
+		for (int c = 0; c < outputChannels; c++) {
+			for (int o = 0; o < numOutputs; o++) {
+				if (c < module->outputs[o].getChannels())
+					module->outputs[o].setVoltage(outputSamples[c * outputStride + o], c);
+			}
+		}
+
+		for (int c = 0; c < inputChannels; c++) {
+			for (int i = 0; i < numInputs; i++)
+				module->inputs[i].setVoltage(savedInputs[c * inputStride + i], c);
+		}
+	}
+};
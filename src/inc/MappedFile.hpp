@@ -0,0 +1,111 @@
+//----------------------------------------------------------------------------
+//	Lunetta Modula Plugin for VCV Rack by Count Modula
+//	Mapped File - read only memory mapped view of a file
+//  Copyright (C) 2026  Adam Verspaget
+//----------------------------------------------------------------------------
+#pragma once
+
+#if defined ARCH_WIN
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+// maps the whole of a file into memory so large side files can be read in place rather than being
+// copied through a stream buffer. The view is released when the object goes out of scope.
+struct MappedFile {
+	const uint8_t *data = NULL;
+	size_t size = 0;
+
+#if defined ARCH_WIN
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+#endif
+
+	~MappedFile() {
+		close();
+	}
+
+	bool open(const std::string &path) {
+		close();
+
+#if defined ARCH_WIN
+		file = CreateFileW(string::UTF8toUTF16(path).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0) {
+			close();
+			return false;
+		}
+
+		mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL) {
+			close();
+			return false;
+		}
+
+		data = (const uint8_t *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (data == NULL) {
+			close();
+			return false;
+		}
+
+		size = (size_t)fileSize.QuadPart;
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+			::close(fd);
+			return false;
+		}
+
+		// the mapping holds its own reference to the file so the descriptor isn't needed once it's made
+		void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+
+		if (p == MAP_FAILED)
+			return false;
+
+		data = (const uint8_t *)p;
+		size = (size_t)st.st_size;
+#endif
+
+		return true;
+	}
+
+	void close() {
+#if defined ARCH_WIN
+		if (data)
+			UnmapViewOfFile(data);
+
+		if (mapping)
+			CloseHandle(mapping);
+
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+
+		mapping = NULL;
+		file = INVALID_HANDLE_VALUE;
+#else
+		if (data)
+			munmap((void *)data, size);
+#endif
+
+		data = NULL;
+		size = 0;
+	}
+};
@@ -0,0 +1,513 @@
+//----------------------------------------------------------------------------
+//	Lunetta Modula Plugin for VCV Rack by Count Modula
+//	Truth Table File - PLA and CSV import/export for the truth table modules
+//  Copyright (C) 2026  Adam Verspaget
+//----------------------------------------------------------------------------
+#pragma once
+
+#include <osdialog.h>
+#include <sstream>
+#include <cstring>
+#include <cctype>
+
+#define TRUTH_TABLE_MAX_INPUTS 8
+#define TRUTH_TABLE_MAX_OUTPUTS 8
+#define TRUTH_TABLE_MAX_ENTRIES (1 << TRUTH_TABLE_MAX_INPUTS)
+
+#define TRUTH_TABLE_FILE_FILTERS "Truth tables (.pla .csv):pla,csv;PLA (.pla):pla;CSV (.csv):csv"
+
+//----------------------------------------------------------------------------
+//	product term - the inputs selected by mask must match value, the rest are don't cares
+//----------------------------------------------------------------------------
+struct TruthTableTerm {
+	int value = 0;
+	int mask = 0;
+
+	TruthTableTerm(int v, int m) : value(v & m), mask(m) {}
+
+	bool covers(int entry) const {
+		return (entry & mask) == value;
+	}
+};
+
+//----------------------------------------------------------------------------
+//	truth table of up to 8 inputs and 8 outputs. Input A is the most significant bit of the entry
+//	number and output n is bit n of each entry.
+//----------------------------------------------------------------------------
+struct TruthTable {
+	int numInputs = 0;
+	int numOutputs = 0;
+	uint8_t entries[TRUTH_TABLE_MAX_ENTRIES] = {};
+
+	int numEntries() const {
+		return 1 << numInputs;
+	}
+
+	bool get(int entry, int output) const {
+		return (entries[entry] >> output) & 1;
+	}
+
+	void set(int entry, int output, bool state) {
+		if (state)
+			entries[entry] |= (1 << output);
+		else
+			entries[entry] &= ~(1 << output);
+	}
+
+	void clear() {
+		for (int e = 0; e < TRUTH_TABLE_MAX_ENTRIES; e++)
+			entries[e] = 0;
+	}
+
+	// minimal sum of products for the given output using Quine-McCluskey. The prime implicants are found
+	// by repeatedly merging terms that differ in a single input, then the essential primes are taken and
+	// whatever is left uncovered goes to the prime covering the most of it. That last step isn't
+	// guaranteed minimal but at 8 inputs it is never far off.
+	std::vector<TruthTableTerm> minimise(int output) const {
+		int full = numEntries() - 1;
+
+		std::vector<int> minterms;
+		std::vector<TruthTableTerm> terms;
+		for (int e = 0; e < numEntries(); e++) {
+			if (get(e, output)) {
+				minterms.push_back(e);
+				terms.push_back(TruthTableTerm(e, full));
+			}
+		}
+
+		std::vector<TruthTableTerm> primes;
+		while (!terms.empty()) {
+			std::vector<TruthTableTerm> merged;
+			std::vector<bool> used(terms.size(), false);
+			std::vector<bool> seen(TRUTH_TABLE_MAX_ENTRIES * TRUTH_TABLE_MAX_ENTRIES, false);
+
+			for (size_t i = 0; i < terms.size(); i++) {
+				for (size_t j = i + 1; j < terms.size(); j++) {
+					int diff = terms[i].value ^ terms[j].value;
+					if (terms[i].mask != terms[j].mask || (diff & (diff - 1)) != 0)
+						continue;
+
+					used[i] = used[j] = true;
+
+					TruthTableTerm t(terms[i].value, terms[i].mask & ~diff);
+					if (!seen[t.mask * TRUTH_TABLE_MAX_ENTRIES + t.value]) {
+						seen[t.mask * TRUTH_TABLE_MAX_ENTRIES + t.value] = true;
+						merged.push_back(t);
+					}
+				}
+			}
+
+			for (size_t i = 0; i < terms.size(); i++) {
+				if (!used[i])
+					primes.push_back(terms[i]);
+			}
+
+			terms = merged;
+		}
+
+		std::vector<TruthTableTerm> cover;
+		std::vector<bool> selected(primes.size(), false);
+
+		// essential primes - the only prime covering one of the minterms
+		for (int m : minterms) {
+			int count = 0, which = 0;
+			for (size_t p = 0; p < primes.size(); p++) {
+				if (primes[p].covers(m)) {
+					count++;
+					which = p;
+				}
+			}
+
+			if (count == 1 && !selected[which]) {
+				selected[which] = true;
+				cover.push_back(primes[which]);
+			}
+		}
+
+		// then the rest, most useful prime first
+		while (true) {
+			std::vector<int> uncovered;
+			for (int m : minterms) {
+				bool covered = false;
+				for (const TruthTableTerm &t : cover)
+					covered = covered || t.covers(m);
+
+				if (!covered)
+					uncovered.push_back(m);
+			}
+
+			if (uncovered.empty())
+				break;
+
+			int best = -1, bestCount = 0;
+			for (size_t p = 0; p < primes.size(); p++) {
+				if (selected[p])
+					continue;
+
+				int count = 0;
+				for (int m : uncovered)
+					count += primes[p].covers(m) ? 1 : 0;
+
+				if (count > bestCount) {
+					bestCount = count;
+					best = p;
+				}
+			}
+
+			selected[best] = true;
+			cover.push_back(primes[best]);
+		}
+
+		return cover;
+	}
+
+	// input part of a PLA line, input A first
+	std::string termString(const TruthTableTerm &t) const {
+		std::string s;
+		for (int i = numInputs - 1; i >= 0; i--)
+			s += (t.mask >> i) & 1 ? ((t.value >> i) & 1 ? '1' : '0') : '-';
+
+		return s;
+	}
+
+	// Berkeley PLA (type fd) listing the on-set of every output, either one line per entry or minimised
+	std::string toPLA(bool minimised) const {
+		std::vector<std::string> lines;
+
+		if (minimised) {
+			// each output is minimised on its own, terms shared between outputs are written once
+			std::vector<TruthTableTerm> terms;
+			std::vector<int> outputs;
+			for (int o = 0; o < numOutputs; o++) {
+				for (const TruthTableTerm &t : minimise(o)) {
+					size_t i = 0;
+					while (i < terms.size() && (terms[i].value != t.value || terms[i].mask != t.mask))
+						i++;
+
+					if (i == terms.size()) {
+						terms.push_back(t);
+						outputs.push_back(0);
+					}
+
+					outputs[i] |= 1 << o;
+				}
+			}
+
+			for (size_t i = 0; i < terms.size(); i++)
+				lines.push_back(termString(terms[i]) + " " + outputString(outputs[i]));
+		}
+		else {
+			for (int e = 0; e < numEntries(); e++) {
+				if (entries[e])
+					lines.push_back(termString(TruthTableTerm(e, numEntries() - 1)) + " " + outputString(entries[e]));
+			}
+		}
+
+		std::string s = rack::string::f(".i %d\n.o %d\n.ilb", numInputs, numOutputs);
+		for (int i = 0; i < numInputs; i++)
+			s += rack::string::f(" %c", 'A' + i);
+
+		s += "\n.ob";
+		for (int o = 0; o < numOutputs; o++)
+			s += rack::string::f(" Q%d", o + 1);
+
+		s += rack::string::f("\n.type fd\n.p %d\n", (int)lines.size());
+		for (const std::string &line : lines)
+			s += line + "\n";
+
+		return s + ".e\n";
+	}
+
+	std::string outputString(int bits) const {
+		std::string s;
+		for (int o = 0; o < numOutputs; o++)
+			s += (bits >> o) & 1 ? '1' : '0';
+
+		return s;
+	}
+
+	// every entry of the table, one row each with a header naming the columns
+	std::string toCSV() const {
+		std::string s;
+		for (int i = 0; i < numInputs; i++)
+			s += rack::string::f("%c,", 'A' + i);
+
+		for (int o = 0; o < numOutputs; o++)
+			s += rack::string::f(o == numOutputs - 1 ? "Q%d\n" : "Q%d,", o + 1);
+
+		for (int e = 0; e < numEntries(); e++) {
+			for (int i = numInputs - 1; i >= 0; i--)
+				s += (e >> i) & 1 ? "1," : "0,";
+
+			for (int o = 0; o < numOutputs; o++)
+				s += get(e, o) ? (o == numOutputs - 1 ? "1\n" : "1,") : (o == numOutputs - 1 ? "0\n" : "0,");
+		}
+
+		return s;
+	}
+
+	// set the on-set of the given outputs for every entry the input part covers, '-' being a don't care
+	bool applyTerm(const std::string &in, const std::string &out, std::string &error) {
+		int value = 0, mask = 0;
+		for (int i = 0; i < numInputs; i++) {
+			int bit = 1 << (numInputs - 1 - i);
+			switch (in[i]) {
+				case '1':
+					value |= bit;
+					mask |= bit;
+					break;
+				case '0':
+					mask |= bit;
+					break;
+				case '-':
+				case 'x':
+				case 'X':
+				case '2':
+					break;
+				default:
+					error = "Unexpected input value '" + in.substr(i, 1) + "'";
+					return false;
+			}
+		}
+
+		TruthTableTerm t(value, mask);
+		for (int e = 0; e < numEntries(); e++) {
+			if (!t.covers(e))
+				continue;
+
+			for (int o = 0; o < numOutputs; o++) {
+				if (out[o] == '1' || out[o] == '4')
+					set(e, o, true);
+			}
+		}
+
+		return true;
+	}
+
+	bool fromPLA(const std::string &text, std::string &error) {
+		numInputs = numOutputs = 0;
+		clear();
+
+		std::istringstream stream(text);
+		std::string line;
+		while (std::getline(stream, line)) {
+			line = line.substr(0, line.find('#'));
+
+			std::istringstream fields(line);
+			std::string keyword;
+			if (!(fields >> keyword))
+				continue;
+
+			if (keyword == ".i")
+				fields >> numInputs;
+			else if (keyword == ".o")
+				fields >> numOutputs;
+			else if (keyword == ".e" || keyword == ".end")
+				break;
+			else if (keyword[0] != '.') {
+				// the input and output parts may or may not be separated
+				std::string term = keyword, s;
+				while (fields >> s)
+					term += s;
+
+				if (!checkSize(error))
+					return false;
+
+				if ((int)term.size() != numInputs + numOutputs) {
+					error = "Term '" + term + "' doesn't match the number of inputs and outputs";
+					return false;
+				}
+
+				if (!applyTerm(term.substr(0, numInputs), term.substr(numInputs), error))
+					return false;
+			}
+		}
+
+		return checkSize(error);
+	}
+
+	// rows of 0/1 values, one column per input followed by the outputs. A header row naming the columns
+	// is optional, output columns being the ones with names starting with Q. Without one the number of
+	// inputs already set is assumed.
+	bool fromCSV(const std::string &text, std::string &error) {
+		int rowInputs = numInputs;
+		numOutputs = 0;
+		clear();
+
+		std::istringstream stream(text);
+		std::string line;
+		bool first = true;
+		while (std::getline(stream, line)) {
+			std::vector<std::string> cells;
+			std::string cell;
+			for (char c : line) {
+				if (c == ',' || c == ';' || c == '\t') {
+					cells.push_back(cell);
+					cell.clear();
+				}
+				else if (c != ' ' && c != '"' && c != '\r')
+					cell += c;
+			}
+
+			cells.push_back(cell);
+			if (cells.size() == 1 && cells[0].empty())
+				continue;
+
+			if (first) {
+				first = false;
+				if (cells[0].empty() || !strchr("01-xX", cells[0][0])) {
+					rowInputs = 0;
+					while (rowInputs < (int)cells.size() && toupper(cells[rowInputs][0]) != 'Q')
+						rowInputs++;
+
+					continue;
+				}
+			}
+
+			if (numOutputs == 0) {
+				numInputs = rowInputs;
+				numOutputs = (int)cells.size() - numInputs;
+
+				if (!checkSize(error))
+					return false;
+			}
+
+			if ((int)cells.size() != numInputs + numOutputs) {
+				error = "Row '" + line + "' doesn't match the number of inputs and outputs";
+				return false;
+			}
+
+			std::string in, out;
+			for (int i = 0; i < numInputs + numOutputs; i++)
+				(i < numInputs ? in : out) += cells[i].empty() ? '?' : cells[i][0];
+
+			if (!applyTerm(in, out, error))
+				return false;
+		}
+
+		return checkSize(error);
+	}
+
+	bool checkSize(std::string &error) {
+		if (numInputs < 1 || numInputs > TRUTH_TABLE_MAX_INPUTS) {
+			error = rack::string::f("Tables must have from 1 to %d inputs", TRUTH_TABLE_MAX_INPUTS);
+			return false;
+		}
+
+		if (numOutputs < 1 || numOutputs > TRUTH_TABLE_MAX_OUTPUTS) {
+			error = rack::string::f("Tables must have from 1 to %d outputs", TRUTH_TABLE_MAX_OUTPUTS);
+			return false;
+		}
+
+		return true;
+	}
+
+	// the file type is taken from the extension, anything other than .csv being read as PLA
+	bool load(const std::string &path, std::string &error) {
+		FILE *file = fopen(path.c_str(), "rb");
+		if (!file) {
+			error = "Unable to open " + path;
+			return false;
+		}
+
+		std::string text;
+		char buffer[4096];
+		size_t n;
+		while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+			text.append(buffer, n);
+
+		fclose(file);
+
+		if (rack::string::lowercase(system::getExtension(path)) == ".csv")
+			return fromCSV(text, error);
+
+		return fromPLA(text, error);
+	}
+
+	bool save(const std::string &path, const std::string &text, std::string &error) {
+		FILE *file = fopen(path.c_str(), "wb");
+		if (!file) {
+			error = "Unable to create " + path;
+			return false;
+		}
+
+		fwrite(text.data(), 1, text.size(), file);
+		fclose(file);
+
+		return true;
+	}
+};
+
+//----------------------------------------------------------------------------
+//	context menu items - the module provides getTruthTable() and setTruthTable() to move its
+//	states to and from a table
+//----------------------------------------------------------------------------
+template <class TModule>
+struct TruthTableImportMenuItem : MenuItem {
+	TModule *module;
+
+	void onAction(const event::Action &e) override {
+		osdialog_filters *filters = osdialog_filters_parse(TRUTH_TABLE_FILE_FILTERS);
+		char *path = osdialog_file(OSDIALOG_OPEN, NULL, NULL, filters);
+		osdialog_filters_free(filters);
+
+		if (!path)
+			return;
+
+		// start from the module's own table so a CSV file without a header takes its size from the module
+		TruthTable table;
+		module->getTruthTable(table);
+
+		std::string error;
+		if (!table.load(path, error) || !module->setTruthTable(table, error))
+			osdialog_message(OSDIALOG_WARNING, OSDIALOG_OK, error.c_str());
+
+		std::free(path);
+	}
+};
+
+template <class TModule>
+struct TruthTableExportMenuItem : MenuItem {
+	TModule *module;
+	bool csv = false;
+	bool minimised = false;
+
+	void onAction(const event::Action &e) override {
+		osdialog_filters *filters = osdialog_filters_parse(csv ? "CSV (.csv):csv" : "PLA (.pla):pla");
+		char *path = osdialog_file(OSDIALOG_SAVE, NULL, csv ? "table.csv" : "table.pla", filters);
+		osdialog_filters_free(filters);
+
+		if (!path)
+			return;
+
+		TruthTable table;
+		module->getTruthTable(table);
+
+		std::string error;
+		if (!table.save(path, csv ? table.toCSV() : table.toPLA(minimised), error))
+			osdialog_message(OSDIALOG_WARNING, OSDIALOG_OK, error.c_str());
+
+		std::free(path);
+	}
+};
+
+template <class TModule>
+void appendTruthTableMenu(Menu *menu, TModule *module) {
+	TruthTableImportMenuItem<TModule> *importItem = createMenuItem<TruthTableImportMenuItem<TModule>>("Import table...");
+	importItem->module = module;
+	menu->addChild(importItem);
+
+	TruthTableExportMenuItem<TModule> *plaItem = createMenuItem<TruthTableExportMenuItem<TModule>>("Export table as PLA...");
+	plaItem->module = module;
+	menu->addChild(plaItem);
+
+	TruthTableExportMenuItem<TModule> *minimisedItem = createMenuItem<TruthTableExportMenuItem<TModule>>("Export minimised table as PLA...");
+	minimisedItem->module = module;
+	minimisedItem->minimised = true;
+	menu->addChild(minimisedItem);
+
+	TruthTableExportMenuItem<TModule> *csvItem = createMenuItem<TruthTableExportMenuItem<TModule>>("Export table as CSV...");
+	csvItem->module = module;
+	csvItem->csv = true;
+	menu->addChild(csvItem);
+}
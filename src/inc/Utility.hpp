@@ -12,7 +12,299 @@
 #define boolToGate(x) x ? gateVoltage : 0.0f
 #define boolToLight(x) x ? 1.0f : 0.0f 
 #define boolToGateInverted(x) x ? 0.0f : gateVoltage
-#define boolToLightInverted(x) x ? 0.0f : 1.0f 
+#define boolToLightInverted(x) x ? 0.0f : 1.0f
+
+// gates for each combination of 4 channels, used to write a word holding one bit per channel to an output
+static const float CHANNEL_GATES[16][4] = {
+	{0, 0, 0, 0}, {1, 0, 0, 0}, {0, 1, 0, 0}, {1, 1, 0, 0},
+	{0, 0, 1, 0}, {1, 0, 1, 0}, {0, 1, 1, 0}, {1, 1, 1, 0},
+	{0, 0, 0, 1}, {1, 0, 0, 1}, {0, 1, 0, 1}, {1, 1, 0, 1},
+	{0, 0, 1, 1}, {1, 0, 1, 1}, {0, 1, 1, 1}, {1, 1, 1, 1}
+};
+
+// write a word holding one bit per channel, the first channel in bit 0, to the given number of channels of an output
+inline void setChannelGates(Output &output, int bits, int channels, float gateVoltage) {
+	for (int c = 0; c < channels; c += 4)
+		output.setVoltageSimd(simd::float_4::load(CHANNEL_GATES[(bits >> c) & 0x0F]) * gateVoltage, c);
+		
+	output.setChannels(channels);
+}
+
+// output edge model - gives the otherwise ideal gate outputs finite rise and fall times by running a one pole
+// filter on each output. Outputs are packed channel major, 4 to a SIMD lane, and any group of 4 that has
+// settled on its target is skipped entirely.
+struct OutputEdgeModel {
+	bool enabled = false;
+
+	// 10-90% rise and fall times in seconds, 0 = ideal edge
+	float riseTime = 0.0f;
+	float fallTime = 0.0f;
+
+	float riseCoeff = 1.0f;
+	float fallCoeff = 1.0f;
+	float sampleTime = 0.0f;
+
+	int numOutputs = 0;
+	int stride = 0;
+
+	// ideal voltages as written by the logic and the current voltage of the edge for each output
+	std::vector<float> target;
+	std::vector<float> value;
+
+	// which groups of 4 outputs are still moving
+	std::vector<bool> moving;
+
+	OutputEdgeModel(int nOutputs) {
+		numOutputs = nOutputs;
+		stride = (numOutputs + 3) & ~3;
+
+		target.resize(PORT_MAX_CHANNELS * stride);
+		value.resize(PORT_MAX_CHANNELS * stride);
+		moving.resize(PORT_MAX_CHANNELS * stride / 4);
+	}
+
+	void setEdgeTimes(float rise, float fall) {
+		riseTime = std::max(rise, 0.0f);
+		fallTime = std::max(fall, 0.0f);
+		enabled = (riseTime > 0.0f || fallTime > 0.0f);
+
+		// force the coefficients to be recalculated
+		sampleTime = 0.0f;
+	}
+
+	// one pole coefficient that gives the required 10-90% time (2.2 time constants)
+	float edgeCoeff(float edgeTime) {
+		return edgeTime > 0.0f ? 1.0f - std::exp(-2.2f * sampleTime / edgeTime) : 1.0f;
+	}
+
+	void process(Module *module, float sTime) {
+		if (sTime != sampleTime) {
+			sampleTime = sTime;
+			riseCoeff = edgeCoeff(riseTime);
+			fallCoeff = edgeCoeff(fallTime);
+		}
+
+		int channels = 1;
+		for (int o = 0; o < numOutputs; o++)
+			channels = std::max(channels, module->outputs[o].getChannels());
+
+		for (int c = 0, g = 0; c < channels; c++) {
+			for (int o = 0; o < stride; o += 4, g++) {
+				float *t = &target[c * stride + o];
+				float *v = &value[c * stride + o];
+				int n = std::min(4, numOutputs - o);
+
+				// an output that no longer holds the value we last gave it has been written by the logic
+				bool changed = false;
+				for (int i = 0; i < n; i++) {
+					float out = module->outputs[o + i].getVoltage(c);
+					if (out != v[i]) {
+						t[i] = out;
+						changed = true;
+					}
+				}
+
+				if (!changed && !moving[g])
+					continue;
+
+				simd::float_4 vt = simd::float_4::load(t);
+				simd::float_4 vv = simd::float_4::load(v);
+				simd::float_4 coeff = simd::ifelse(vt > vv, simd::float_4(riseCoeff), simd::float_4(fallCoeff));
+				vv += coeff * (vt - vv);
+
+				// snap to the target once we're close enough
+				simd::float_4 settled = simd::fabs(vt - vv) < simd::float_4(1e-3f);
+				vv = simd::ifelse(settled, vt, vv);
+				vv.store(v);
+				moving[g] = (simd::movemask(settled) != 0xF);
+
+				for (int i = 0; i < n; i++)
+					module->outputs[o + i].setVoltage(v[i], c);
+			}
+		}
+	}
+};
+
+// propagation delay - delays each selected output by a whole or fractional number of samples. The delay lines
+// are preallocated rings holding one bit per channel per sample so the cost depends only on the number of
+// outputs being delayed, not on the length of the delay.
+#define PROPAGATION_DELAY_BUFFER_SIZE 1024
+#define PROPAGATION_DELAY_BUFFER_MASK 1023
+
+struct PropagationDelay {
+	bool enabled = false;
+
+	int numOutputs = 0;
+	unsigned int writePos = 0;
+	float sampleRate = 0.0f;
+
+	// requested delay for each output, either in samples or microseconds
+	std::vector<float> amount;
+	std::vector<bool> inSamples;
+
+	// the requested delays converted to whole samples plus a fraction at the current sample rate
+	std::vector<int> delaySamples;
+	std::vector<float> delayFraction;
+
+	// the outputs that actually have a delay set
+	std::vector<int> delayed;
+	int numDelayed = 0;
+
+	// channel bits for each output at each sample and the most recent undelayed values
+	std::vector<uint16_t> buffer;
+	std::vector<uint16_t> current;
+
+	PropagationDelay(int nOutputs) {
+		numOutputs = nOutputs;
+
+		amount.resize(numOutputs, 0.0f);
+		inSamples.resize(numOutputs, true);
+		delaySamples.resize(numOutputs, 0);
+		delayFraction.resize(numOutputs, 0.0f);
+		delayed.resize(numOutputs, 0);
+		buffer.resize(numOutputs * PROPAGATION_DELAY_BUFFER_SIZE, 0);
+		current.resize(numOutputs, 0);
+	}
+
+	void setDelay(int output, float delayAmount, bool delayInSamples) {
+		amount[output] = std::max(delayAmount, 0.0f);
+		inSamples[output] = delayInSamples;
+
+		// rebuild the list of delayed outputs
+		int n = 0;
+		for (int o = 0; o < numOutputs; o++) {
+			if (amount[o] > 0.0f)
+				delayed[n++] = o;
+		}
+
+		numDelayed = n;
+		enabled = (n > 0);
+
+		// force the delay times to be recalculated
+		sampleRate = 0.0f;
+	}
+
+	void calculateDelays() {
+		for (int o = 0; o < numOutputs; o++) {
+			float d = inSamples[o] ? amount[o] : amount[o] * sampleRate * 1e-6f;
+			d = clamp(d, 0.0f, (float)(PROPAGATION_DELAY_BUFFER_SIZE - 2));
+
+			delaySamples[o] = (int)d;
+			delayFraction[o] = d - (float)delaySamples[o];
+		}
+	}
+
+	// put the undelayed output values back so the logic always sees its own last output
+	void restore(Module *module, float gateVoltage) {
+		for (int i = 0; i < numDelayed; i++) {
+			int o = delayed[i];
+			uint16_t bits = current[o];
+			int channels = module->outputs[o].getChannels();
+
+			for (int c = 0; c < channels; c++)
+				module->outputs[o].setVoltage(((bits >> c) & 1) ? gateVoltage : 0.0f, c);
+		}
+	}
+
+	void process(Module *module, float sRate, float gateVoltage) {
+		if (sRate != sampleRate) {
+			sampleRate = sRate;
+			calculateDelays();
+		}
+
+		float threshold = gateVoltage * 0.5f;
+		writePos = (writePos + 1) & PROPAGATION_DELAY_BUFFER_MASK;
+
+		for (int i = 0; i < numDelayed; i++) {
+			int o = delayed[i];
+			uint16_t *line = &buffer[o * PROPAGATION_DELAY_BUFFER_SIZE];
+			int channels = module->outputs[o].getChannels();
+
+			// pack the current state of each channel into the delay line
+			uint16_t bits = 0;
+			for (int c = 0; c < channels; c++) {
+				if (module->outputs[o].getVoltage(c) > threshold)
+					bits |= (1 << c);
+			}
+
+			current[o] = bits;
+			line[writePos] = bits;
+
+			// and read back the delayed state, blending with the next oldest sample for fractional delays
+			uint16_t a = line[(writePos - delaySamples[o]) & PROPAGATION_DELAY_BUFFER_MASK];
+			uint16_t b = line[(writePos - delaySamples[o] - 1) & PROPAGATION_DELAY_BUFFER_MASK];
+			float f = delayFraction[o];
+
+			for (int c = 0; c < channels; c++) {
+				float v = (float)((a >> c) & 1) * (1.0f - f) + (float)((b >> c) & 1) * f;
+				module->outputs[o].setVoltage(v * gateVoltage, c);
+			}
+		}
+	}
+};
+
+// input peak hold - used when running the logic at control rate to hold the lowest and highest voltages seen
+// on each input over the block. Whichever of the two is furthest from what the logic was last shown is
+// presented, so a pulse shorter than the block is seen whichever way it goes. A pulse that returns to where
+// it started within the block shows up as a change on one evaluation and the change back on the next.
+struct InputPeakHold {
+	int numInputs = 0;
+	int channels = 1;
+	bool newBlock = true;
+
+	// voltages laid out as [channel][input]
+	std::vector<float> low;
+	std::vector<float> high;
+	std::vector<float> presented;
+
+	InputPeakHold(int nInputs) {
+		numInputs = nInputs;
+		low.resize(PORT_MAX_CHANNELS * numInputs, 0.0f);
+		high.resize(PORT_MAX_CHANNELS * numInputs, 0.0f);
+		presented.resize(PORT_MAX_CHANNELS * numInputs, 0.0f);
+	}
+
+	void reset() {
+		newBlock = true;
+		std::fill(presented.begin(), presented.end(), 0.0f);
+	}
+
+	void process(Module *module) {
+		if (newBlock) {
+			channels = 1;
+			for (int i = 0; i < numInputs; i++)
+				channels = std::max(channels, module->inputs[i].getChannels());
+		}
+
+		for (int c = 0; c < channels; c++) {
+			float *l = &low[c * numInputs];
+			float *h = &high[c * numInputs];
+			for (int i = 0; i < numInputs; i++) {
+				float v = module->inputs[i].getVoltage(c);
+				l[i] = newBlock ? v : std::min(l[i], v);
+				h[i] = newBlock ? v : std::max(h[i], v);
+			}
+		}
+
+		newBlock = false;
+	}
+
+	// present the held voltages to the logic and start a new block. There's no need to put the original
+	// voltages back afterwards as connected inputs are refreshed by the engine and unconnected ones never change.
+	void load(Module *module) {
+		for (int c = 0; c < channels; c++) {
+			float *l = &low[c * numInputs];
+			float *h = &high[c * numInputs];
+			float *p = &presented[c * numInputs];
+			for (int i = 0; i < numInputs; i++) {
+				p[i] = (p[i] - l[i] > h[i] - p[i]) ? l[i] : h[i];
+				module->inputs[i].setVoltage(p[i], c);
+			}
+		}
+
+		newBlock = true;
+	}
+};
 
 enum CMOSModes {
 	VCVRACK_STANDARD,
@@ -21,4 +313,53 @@ enum CMOSModes {
 	CD40106_SCHMITT
 };
 
+// supply voltage range for CMOS
+#define VDD_MIN 3.0f
+#define VDD_MAX 18.0f
+
+// input thresholds and gate voltage for the selected I/O mode and supply voltage. Calculated once per module
+// and shared by all of that module's inputs so changing either only costs a handful of multiplies.
+struct CMOSThresholds {
+	int mode = VCVRACK_STANDARD;
+	float vdd = VDD;
+
+	// voltages for guaranteed high and low
+	float vLow = 0.1f;
+	float vHigh = 2.0f;
+
+	float gateVoltage = 10.0f;
+
+	void setMode(int ioMode) {
+		mode = ioMode;
+		calculate();
+	}
+
+	void setVdd(float v) {
+		vdd = clamp(v, VDD_MIN, VDD_MAX);
+		calculate();
+	}
+
+	void calculate() {
+		switch(mode) {
+			case CD40106_SCHMITT:
+				vLow = vdd * 0.38f; // approx 4.6V for Vdd = 12V
+				vHigh = vdd * 0.58f; // approx 7V for Vdd = 12V
+				gateVoltage = vdd;
+				break;
+			case CMOS_NON_SCHMITT:
+			case CMOS_SCHMITT:
+				vLow = vdd * 0.3f;
+				vHigh = vdd * 0.7f;
+				gateVoltage = vdd;
+				break;
+			case VCVRACK_STANDARD:
+			default:
+				vLow = 0.1f;
+				vHigh = 2.0f;
+				gateVoltage = 10.0f;
+				break;
+		}
+	}
+};
+
 
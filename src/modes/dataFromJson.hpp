@@ -13,4 +13,45 @@ else
 #endif
 	ioMode = VCVRACK_STANDARD;
 
-setIOMode(ioMode);
\ No newline at end of file
+setIOMode(ioMode);
+
+#ifdef LOGIC_OVERSAMPLING
+json_t* jsonOversample = json_object_get(root, "oversample");
+
+if (jsonOversample)
+	setOversample(json_integer_value(jsonOversample));
+else
+	setOversample(1);
+#endif
+
+#ifdef OUTPUT_EDGE_MODEL
+json_t* jsonRiseTime = json_object_get(root, "riseTime");
+json_t* jsonFallTime = json_object_get(root, "fallTime");
+
+edgeModel.setEdgeTimes(jsonRiseTime ? json_number_value(jsonRiseTime) : 0.0f, jsonFallTime ? json_number_value(jsonFallTime) : 0.0f);
+#endif
+
+#ifdef PROPAGATION_DELAY
+json_t* jsonDelays = json_object_get(root, "propagationDelay");
+
+for (int o = 0; o < NUM_OUTPUTS; o++) {
+	json_t *jsonDelay = jsonDelays ? json_array_get(jsonDelays, o) : NULL;
+	
+	if (jsonDelay) {
+		json_t *jsonAmount = json_object_get(jsonDelay, "amount");
+		json_t *jsonSamples = json_object_get(jsonDelay, "samples");
+		propagationDelay.setDelay(o, jsonAmount ? json_number_value(jsonAmount) : 0.0f, jsonSamples ? json_is_true(jsonSamples) : true);
+	}
+	else
+		propagationDelay.setDelay(o, 0.0f, true);
+}
+#endif
+
+#ifdef CONTROL_RATE
+json_t* jsonControlRate = json_object_get(root, "controlRate");
+
+if (jsonControlRate)
+	setControlRate(json_integer_value(jsonControlRate));
+else
+	setControlRate(1);
+#endif
\ No newline at end of file
@@ -4,3 +4,27 @@
 //  Copyright (C) 2020  Adam Verspaget
 //----------------------------------------------------------------------------
 json_object_set_new(root, "ioMode", json_integer(ioMode));
+
+#ifdef LOGIC_OVERSAMPLING
+json_object_set_new(root, "oversample", json_integer(oversample));
+#endif
+
+#ifdef OUTPUT_EDGE_MODEL
+json_object_set_new(root, "riseTime", json_real(edgeModel.riseTime));
+json_object_set_new(root, "fallTime", json_real(edgeModel.fallTime));
+#endif
+
+#ifdef PROPAGATION_DELAY
+json_t *jsonDelays = json_array();
+for (int o = 0; o < NUM_OUTPUTS; o++) {
+	json_t *jsonDelay = json_object();
+	json_object_set_new(jsonDelay, "amount", json_real(propagationDelay.amount[o]));
+	json_object_set_new(jsonDelay, "samples", json_boolean(propagationDelay.inSamples[o]));
+	json_array_append_new(jsonDelays, jsonDelay);
+}
+json_object_set_new(root, "propagationDelay", jsonDelays);
+#endif
+
+#ifdef CONTROL_RATE
+json_object_set_new(root, "controlRate", json_integer(controlRate));
+#endif
@@ -29,14 +29,14 @@ struct ModeMenu : MenuItem {
 		menu->addChild(standardMenuItem);
 		
 #ifdef CMOS_IO_MODEL
-		// CMOS standard I/O levels: 12V gates, no Schmitt trigger and unstable at the high/low trip point
+		// CMOS standard I/O levels: Vdd gates, no Schmitt trigger and unstable at the high/low trip point
 		ModeMenuItem *cmosNSTMenuItem = createMenuItem<ModeMenuItem>("CMOS Non-Schmitt Trigger", CHECKMARK(module->ioMode == CMOS_NON_SCHMITT));
 		cmosNSTMenuItem->module = module;
 		cmosNSTMenuItem->modeToUse = CMOS_NON_SCHMITT;
 		menu->addChild(cmosNSTMenuItem);
 #endif
 
-		// CMOS Standard I/O levels: 12V gates, Schmitt trigger inputs set at approx 1/3 and 2/3 Vdd (Vdd = 12 Volts here)
+		// CMOS Standard I/O levels: Vdd gates, Schmitt trigger inputs set at approx 1/3 and 2/3 Vdd
 		ModeMenuItem *csmosSTMenuItem = createMenuItem<ModeMenuItem>("CMOS Schmitt Trigger", CHECKMARK(module->ioMode == CMOS_SCHMITT));
 		csmosSTMenuItem->module = module;
 		csmosSTMenuItem->modeToUse = CMOS_SCHMITT;
@@ -45,4 +45,202 @@ struct ModeMenu : MenuItem {
 		return menu;	
 	}
 };
+#endif
+
+#ifdef OVERSAMPLE_MENU
+// oversampling selection menu item
+struct OversampleMenuItem : MenuItem {
+	MODULE_NAME *module;
+	int oversampleToUse = 1;
+	
+	void onAction(const event::Action &e) override {
+		module->setOversample(oversampleToUse);
+	}
+};
+
+// oversampling menu
+struct OversampleMenu : MenuItem {
+	MODULE_NAME *module;
+	
+	Menu *createChildMenu() override {
+		Menu *menu = new Menu;
+
+		const int factors[4] = {1, 2, 4, 8};
+		const std::string labels[4] = {"Off", "2x", "4x", "8x"};
+		
+		for (int i = 0; i < 4; i++) {
+			OversampleMenuItem *oversampleMenuItem = createMenuItem<OversampleMenuItem>(labels[i], CHECKMARK(module->oversample == factors[i]));
+			oversampleMenuItem->module = module;
+			oversampleMenuItem->oversampleToUse = factors[i];
+			menu->addChild(oversampleMenuItem);
+		}
+		
+		return menu;	
+	}
+};
+#endif
+
+#ifdef OUTPUT_EDGE_MODEL
+// rise/fall time selection menu item
+struct EdgeTimeMenuItem : MenuItem {
+	MODULE_NAME *module;
+	bool rising = true;
+	float timeToUse = 0.0f;
+	
+	void onAction(const event::Action &e) override {
+		if (rising)
+			module->edgeModel.setEdgeTimes(timeToUse, module->edgeModel.fallTime);
+		else
+			module->edgeModel.setEdgeTimes(module->edgeModel.riseTime, timeToUse);
+	}
+};
+
+// rise/fall time menu
+struct EdgeTimeMenu : MenuItem {
+	MODULE_NAME *module;
+	bool rising = true;
+	
+	Menu *createChildMenu() override {
+		Menu *menu = new Menu;
+
+		const float times[8] = {0.0f, 10e-6f, 20e-6f, 50e-6f, 100e-6f, 200e-6f, 500e-6f, 1e-3f};
+		const std::string labels[8] = {"Ideal", "10µs", "20µs", "50µs", "100µs", "200µs", "500µs", "1ms"};
+		float current = rising ? module->edgeModel.riseTime : module->edgeModel.fallTime;
+		
+		for (int i = 0; i < 8; i++) {
+			EdgeTimeMenuItem *edgeTimeMenuItem = createMenuItem<EdgeTimeMenuItem>(labels[i], CHECKMARK(current == times[i]));
+			edgeTimeMenuItem->module = module;
+			edgeTimeMenuItem->rising = rising;
+			edgeTimeMenuItem->timeToUse = times[i];
+			menu->addChild(edgeTimeMenuItem);
+		}
+		
+		return menu;	
+	}
+};
+
+// output edge menu
+struct OutputEdgeMenu : MenuItem {
+	MODULE_NAME *module;
+	
+	Menu *createChildMenu() override {
+		Menu *menu = new Menu;
+
+		EdgeTimeMenu *riseMenuItem = createMenuItem<EdgeTimeMenu>("Rise Time", RIGHT_ARROW);
+		riseMenuItem->module = module;
+		riseMenuItem->rising = true;
+		menu->addChild(riseMenuItem);
+
+		EdgeTimeMenu *fallMenuItem = createMenuItem<EdgeTimeMenu>("Fall Time", RIGHT_ARROW);
+		fallMenuItem->module = module;
+		fallMenuItem->rising = false;
+		menu->addChild(fallMenuItem);
+		
+		return menu;	
+	}
+};
+#endif
+
+#ifdef PROPAGATION_DELAY
+// propagation delay selection menu item - output of -1 applies the delay to all outputs
+struct DelayMenuItem : MenuItem {
+	MODULE_NAME *module;
+	int output = -1;
+	float amountToUse = 0.0f;
+	bool samplesToUse = true;
+	
+	void onAction(const event::Action &e) override {
+		for (int o = 0; o < module->propagationDelay.numOutputs; o++) {
+			if (output < 0 || output == o)
+				module->propagationDelay.setDelay(o, amountToUse, samplesToUse);
+		}
+	}
+};
+
+// propagation delay menu for a single output or all outputs
+struct DelayMenu : MenuItem {
+	MODULE_NAME *module;
+	int output = -1;
+	
+	Menu *createChildMenu() override {
+		Menu *menu = new Menu;
+
+		const float amounts[14] = {0.0f, 1.0f, 2.0f, 4.0f, 8.0f, 16.0f, 5.0f, 10.0f, 20.0f, 50.0f, 100.0f, 200.0f, 500.0f, 1000.0f};
+		const bool samples[14] = {true, true, true, true, true, true, false, false, false, false, false, false, false, false};
+		const std::string labels[14] = {"None", "1 sample", "2 samples", "4 samples", "8 samples", "16 samples", "5µs", "10µs", "20µs", "50µs", "100µs", "200µs", "500µs", "1ms"};
+		
+		for (int i = 0; i < 14; i++) {
+			bool selected = false;
+			if (output >= 0)
+				selected = (module->propagationDelay.amount[output] == amounts[i] && (amounts[i] == 0.0f || module->propagationDelay.inSamples[output] == samples[i]));
+				
+			DelayMenuItem *delayMenuItem = createMenuItem<DelayMenuItem>(labels[i], CHECKMARK(selected));
+			delayMenuItem->module = module;
+			delayMenuItem->output = output;
+			delayMenuItem->amountToUse = amounts[i];
+			delayMenuItem->samplesToUse = samples[i];
+			menu->addChild(delayMenuItem);
+		}
+		
+		return menu;	
+	}
+};
+
+// main propagation delay menu
+struct PropagationDelayMenu : MenuItem {
+	MODULE_NAME *module;
+	
+	Menu *createChildMenu() override {
+		Menu *menu = new Menu;
+
+		DelayMenu *allMenuItem = createMenuItem<DelayMenu>("All Outputs", RIGHT_ARROW);
+		allMenuItem->module = module;
+		allMenuItem->output = -1;
+		menu->addChild(allMenuItem);
+		
+		menu->addChild(new MenuSeparator());
+		
+		for (int o = 0; o < module->propagationDelay.numOutputs; o++) {
+			DelayMenu *delayMenuItem = createMenuItem<DelayMenu>(module->outputInfos[o]->name, RIGHT_ARROW);
+			delayMenuItem->module = module;
+			delayMenuItem->output = o;
+			menu->addChild(delayMenuItem);
+		}
+		
+		return menu;	
+	}
+};
+#endif
+
+#ifdef CONTROL_RATE
+// control rate selection menu item
+struct ControlRateMenuItem : MenuItem {
+	MODULE_NAME *module;
+	int rateToUse = 1;
+	
+	void onAction(const event::Action &e) override {
+		module->setControlRate(rateToUse);
+	}
+};
+
+// control rate menu
+struct ControlRateMenu : MenuItem {
+	MODULE_NAME *module;
+	
+	Menu *createChildMenu() override {
+		Menu *menu = new Menu;
+
+		const int rates[6] = {1, 4, 8, 16, 32, 64};
+		const std::string labels[6] = {"Off", "Every 4 samples", "Every 8 samples", "Every 16 samples", "Every 32 samples", "Every 64 samples"};
+		
+		for (int i = 0; i < 6; i++) {
+			ControlRateMenuItem *controlRateMenuItem = createMenuItem<ControlRateMenuItem>(labels[i], CHECKMARK(module->controlRate == rates[i]));
+			controlRateMenuItem->module = module;
+			controlRateMenuItem->rateToUse = rates[i];
+			menu->addChild(controlRateMenuItem);
+		}
+		
+		return menu;	
+	}
+};
 #endif
\ No newline at end of file
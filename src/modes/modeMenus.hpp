@@ -9,3 +9,31 @@ ModeMenu *modeMenuItem = createMenuItem<ModeMenu>("I/O Mode", RIGHT_ARROW);
 modeMenuItem->module = module;
 menu->addChild(modeMenuItem);
 #endif
+
+#ifdef OVERSAMPLE_MENU
+// add the oversampling menu item
+OversampleMenu *oversampleMenuItem = createMenuItem<OversampleMenu>("Oversampling", RIGHT_ARROW);
+oversampleMenuItem->module = module;
+menu->addChild(oversampleMenuItem);
+#endif
+
+#ifdef OUTPUT_EDGE_MODEL
+// add the output edge menu item
+OutputEdgeMenu *outputEdgeMenuItem = createMenuItem<OutputEdgeMenu>("Output Edges", RIGHT_ARROW);
+outputEdgeMenuItem->module = module;
+menu->addChild(outputEdgeMenuItem);
+#endif
+
+#ifdef PROPAGATION_DELAY
+// add the propagation delay menu item
+PropagationDelayMenu *propagationDelayMenuItem = createMenuItem<PropagationDelayMenu>("Propagation Delay", RIGHT_ARROW);
+propagationDelayMenuItem->module = module;
+menu->addChild(propagationDelayMenuItem);
+#endif
+
+#ifdef CONTROL_RATE
+// add the control rate menu item
+ControlRateMenu *controlRateMenuItem = createMenuItem<ControlRateMenu>("Control Rate", RIGHT_ARROW);
+controlRateMenuItem->module = module;
+menu->addChild(controlRateMenuItem);
+#endif
@@ -4,7 +4,75 @@
 //  Copyright (C) 2020  Adam Verspaget
 //----------------------------------------------------------------------------
 
+// the oversampled logic uses the shared oversampling menu, modules that oversample in their own way can
+// define OVERSAMPLE_MENU to use it too
+#ifdef LOGIC_OVERSAMPLING
+#define OVERSAMPLE_MENU
+#endif
+
 // used by bool to gate
 float gateVoltage = 10.0f;
 
 int ioMode = VCVRACK_STANDARD;
+
+// input thresholds and gate voltage for the selected mode, shared by all of the module's inputs
+CMOSThresholds thresholds;
+
+#ifdef LOGIC_OVERSAMPLING
+// oversampling factor for the logic and the filters used to get there and back
+int oversample = 1;
+LogicOversampler oversampler {NUM_INPUTS, NUM_OUTPUTS};
+
+void setOversample(int n) {
+	oversampler.setFactor(n);
+	oversample = oversampler.factor;
+
+#ifdef CONTROL_RATE
+	// control rate and oversampling are mutually exclusive
+	if (oversample > 1) {
+		controlRate = 1;
+		controlRateCount = 0;
+		peakHold.reset();
+	}
+#endif
+}
+#endif
+
+#ifdef OUTPUT_EDGE_MODEL
+// finite rise and fall times for the outputs
+OutputEdgeModel edgeModel {NUM_OUTPUTS};
+#endif
+
+#ifdef PROPAGATION_DELAY
+// per output propagation delay
+PropagationDelay propagationDelay {NUM_OUTPUTS};
+#endif
+
+// outputs that are only written when they change must still be written on every evaluation when the
+// oversampler is replacing them with filtered values
+bool alwaysWriteOutputs() {
+#ifdef LOGIC_OVERSAMPLING
+	return oversample > 1;
+#else
+	return false;
+#endif
+}
+
+#ifdef CONTROL_RATE
+// control rate divisor for the logic and the input peak hold used between evaluations
+int controlRate = 1;
+int controlRateCount = 0;
+InputPeakHold peakHold {NUM_INPUTS};
+
+void setControlRate(int n) {
+	controlRate = clamp(n, 1, 64);
+	controlRateCount = 0;
+	peakHold.reset();
+
+#ifdef LOGIC_OVERSAMPLING
+	// control rate and oversampling are mutually exclusive
+	if (controlRate > 1)
+		setOversample(1);
+#endif
+}
+#endif
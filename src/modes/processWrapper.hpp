@@ -0,0 +1,63 @@
+//----------------------------------------------------------------------------
+//	Lunetta Modula Plugin for VCV Rack by Count Modula
+// 	common process wrapper for running the logic at the selected rate and modelling the outputs
+//  Copyright (C) 2026  Adam Verspaget
+//----------------------------------------------------------------------------
+
+#ifdef PROPAGATION_DELAY
+// put the undelayed outputs back so the logic sees its own last state
+if (propagationDelay.enabled)
+	propagationDelay.restore(this, gateVoltage);
+#endif
+
+#ifdef CONTROL_RATE
+if (controlRate > 1) {
+	// hold the input peaks and only run the logic once per block, the outputs hold their values in between
+	peakHold.process(this);
+
+	if (++controlRateCount >= controlRate) {
+		controlRateCount = 0;
+
+		ProcessArgs controlArgs = args;
+		controlArgs.sampleRate /= controlRate;
+		controlArgs.sampleTime *= controlRate;
+
+		peakHold.load(this);
+		processLogic(controlArgs);
+	}
+}
+else
+#endif
+#ifdef LOGIC_OVERSAMPLING
+if (oversample > 1) {
+	// run the logic at the oversampled rate on the upsampled inputs
+	ProcessArgs oversampledArgs = args;
+	oversampledArgs.sampleRate *= oversample;
+	oversampledArgs.sampleTime /= oversample;
+
+	oversampler.upsample(this);
+
+	for (int s = 0; s < oversample; s++) {
+		oversampler.loadInputs(this, s);
+		processLogic(oversampledArgs);
+		oversampler.storeOutputs(this, s);
+	}
+
+	// and bring the results back down to the engine rate
+	oversampler.decimate(this);
+}
+else
+#endif
+	processLogic(args);
+
+#ifdef PROPAGATION_DELAY
+// delay the outputs if required
+if (propagationDelay.enabled)
+	propagationDelay.process(this, args.sampleRate, gateVoltage);
+#endif
+
+#ifdef OUTPUT_EDGE_MODEL
+// soften the output edges if required
+if (edgeModel.enabled)
+	edgeModel.process(this, args.sampleTime);
+#endif
@@ -4,4 +4,6 @@
 //  Copyright (C) 2020  Adam Verspaget
 //----------------------------------------------------------------------------
 
-gateVoltage = (mode == VCVRACK_STANDARD ? 10.0f : VDD);
\ No newline at end of file
+// update the thresholds shared by the inputs and take the gate voltage from them
+thresholds.setMode(mode);
+gateVoltage = thresholds.gateVoltage;
\ No newline at end of file
@@ -5,9 +5,14 @@
 //----------------------------------------------------------------------------
 #include "../LunettaModula.hpp"
 #include "../inc/Utility.hpp"
+#include "../inc/CMOSInput.hpp"
+#include "../inc/LogicOversampler.hpp"
 
 // used by mode management includes
 #define MODULE_NAME ADC
+#define OVERSAMPLE_MENU
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
 
 struct ADC : Module {
 	enum ParamIds {
@@ -18,6 +23,7 @@ struct ADC : Module {
 	};
 	enum InputIds {
 		ANALOGUE_INPUT,
+		CLOCK_INPUT,
 		NUM_INPUTS
 	};
 	enum OutputIds {
@@ -32,9 +38,36 @@ struct ADC : Module {
 	
 	// add the variables we'll use when managing modes
 	#include "../modes/modeVariables.hpp"
-	int prevValue = 0;
 	
-	float outs[8] = {};
+	// clock inputs for sample and hold conversion, one per channel
+	CMOSInput clockInputs[PORT_MAX_CHANNELS];
+	bool prevClock[PORT_MAX_CHANNELS] = {};
+	
+	// the most recent conversion for each channel
+	int digitalValue[PORT_MAX_CHANNELS] = {};
+	int prevValue = -1;
+	
+	// TPDF dither applied ahead of the quantiser
+	bool dither = false;
+	
+	// oversampled converter - the analogue input is interpolated up, quantised at the oversampled rate and
+	// the codes filtered back down and rounded, so the bit outputs are always clean gates. Each filter
+	// handles 4 channels.
+	int oversample = 1;
+	int oversampleStages = 0;
+	HalfBandUpsampler upsamplers[OVERSAMPLING_MAX_STAGES][PORT_MAX_CHANNELS / 4];
+	HalfBandDecimator decimators[OVERSAMPLING_MAX_STAGES][PORT_MAX_CHANNELS / 4];
+	float oversampledCode[PORT_MAX_CHANNELS] = {};
+	
+	// converter settings, only updated every few samples
+	int processCount = 16;
+	int bits = 8;
+	float level = 1.0f;
+	float vRef = 10.0f;
+	float fullScale = 255.0f;
+	float scale = 25.5f;
+	float overloadLimit = 10.0f;
+	bool overload = false;
 	
 	ADC() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
@@ -44,11 +77,12 @@ struct ADC : Module {
 		configParam(REFERENCE_PARAM, 1.0f, 10.0f, 10.0f, "Reference voltage", " Volts");
 		
 		configInput(ANALOGUE_INPUT, "Analogue");
+		configInput(CLOCK_INPUT, "Clock");
+		inputInfos[CLOCK_INPUT]->description = "Converts on the rising edge when connected, otherwise on every sample";
 		
 		setIOMode(VCVRACK_STANDARD);
 		
 		for (int b = 0; b < 8; b++) {
-			outs[b] = 0.0f;
 			configOutput(BIT_OUTPUTS + b, rack::string::f("Bit %d", b + 1));
 		}
 		
@@ -57,10 +91,47 @@ struct ADC : Module {
 	}
 	
 	void onReset() override {
-
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++) {
+			clockInputs[c].reset();
+			prevClock[c] = false;
+			digitalValue[c] = 0;
+		}
+		
+		prevValue = -1;
+		processCount = 16;
+		setOversample(oversample);
+	}
+	
+	void setOversample(int n) {
+		switch (n) {
+			case 2:
+				oversampleStages = 1;
+				break;
+			case 4:
+				oversampleStages = 2;
+				break;
+			case 8:
+				oversampleStages = 3;
+				break;
+			default:
+				n = 1;
+				oversampleStages = 0;
+				break;
+		}
+		
+		oversample = n;
+		
+		for (int s = 0; s < OVERSAMPLING_MAX_STAGES; s++) {
+			for (int g = 0; g < PORT_MAX_CHANNELS / 4; g++) {
+				upsamplers[s][g].reset();
+				decimators[s][g].reset();
+			}
+		}
 	}
 	
 	void setIOMode (int mode) {
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++)
+			clockInputs[c].setThresholds(&thresholds);
 		
 		// set gate voltage
 		#include "../modes/setGateVoltage.hpp"
@@ -71,6 +142,9 @@ struct ADC : Module {
 
 		json_object_set_new(root, "moduleVersion", json_integer(1));
 
+		json_object_set_new(root, "dither", json_boolean(dither));
+		json_object_set_new(root, "oversample", json_integer(oversample));
+		
 		// add the I/O mode details
 		#include "../modes/dataToJson.hpp"		
 		
@@ -79,6 +153,12 @@ struct ADC : Module {
 	
 	void dataFromJson(json_t *root) override {
 		
+		json_t *jsonDither = json_object_get(root, "dither");
+		dither = jsonDither ? json_boolean_value(jsonDither) : false;
+		
+		json_t *jsonOversample = json_object_get(root, "oversample");
+		setOversample(jsonOversample ? json_integer_value(jsonOversample) : 1);
+		
 		// grab the I/O mode details
 		#include "../modes/dataFromJson.hpp"
 	}	
@@ -88,41 +168,122 @@ struct ADC : Module {
 
 	
 	void process(const ProcessArgs &args) override {
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
+
+	void processLogic(const ProcessArgs &args) {
 
-		// determine bit depth and reference voltage to use
-		int bits = clamp((int)(params[BITS_PARAM].getValue()), 2, 8);
-		float vRef = clamp(params[REFERENCE_PARAM].getValue(), 1.0f, 10.0f);
-		float bitSize = vRef / maxBits[bits];
+		// determine bit depth, input level and reference voltage to use - these don't need updating every sample
+		if (++processCount > 16) {
+			processCount = 0;
+			
+			bits = clamp((int)(params[BITS_PARAM].getValue()), 2, 8);
+			level = params[LEVEL_PARAM].getValue();
+			vRef = clamp(params[REFERENCE_PARAM].getValue(), 1.0f, 10.0f);
+			
+			// digital value = (2^bits -1) * input/reference
+			fullScale = maxBits[bits];
+			scale = fullScale / vRef;
+			overloadLimit = vRef + (vRef / fullScale) / 2.0f;
+			
+			lights[OL_LIGHT].setSmoothBrightness(overload, args.sampleTime * 16);
+			overload = false;
+		}
 		
-		// process incoming analogue value
-		float analogueIn = inputs[ANALOGUE_INPUT].getVoltage() * params[LEVEL_PARAM].getValue();
-		float vIn = clamp(analogueIn, 0.0f, vRef);
-		lights[OL_LIGHT].setSmoothBrightness(analogueIn < 0.0f || analogueIn > (vRef + bitSize/ 2.0f), args.sampleTime);
+		// one set of bit outputs per input channel
+		int channels = std::max(inputs[ANALOGUE_INPUT].getChannels(), 1);
+		bool clocked = inputs[CLOCK_INPUT].isConnected();
 		
-		// digital value = (2^bits -1) * input/reference
-		int digitalValue = (int)(maxBits[bits] * (vIn/vRef));
+		// the oversampled converter has to keep running between clocks to keep its filters current
+		if (oversample > 1)
+			processOversampled(channels);
+		
+		for (int c = 0; c < channels; c++) {
+			// process incoming analogue value
+			float analogueIn = inputs[ANALOGUE_INPUT].getVoltage(c) * level;
+			overload |= (analogueIn < 0.0f || analogueIn > overloadLimit);
+			
+			// a mono clock converts all channels together
+			if (clocked) {
+				bool clock = clockInputs[c].process(inputs[CLOCK_INPUT].getPolyVoltage(c));
+				bool convert = clock && !prevClock[c];
+				prevClock[c] = clock;
+				
+				if (!convert)
+					continue;
+			}
+			
+			if (oversample > 1)
+				digitalValue[c] = (int)oversampledCode[c];
+			else {
+				float code = clamp(analogueIn, 0.0f, vRef) * scale;
+				if (dither)
+					code += random::uniform() - random::uniform();
+				
+				digitalValue[c] = (int)clamp(code, 0.0f, fullScale);
+			}
+		}
 
 		// now set the outputs/lights accordingly
-		if(prevValue != digitalValue) {
-			prevValue = digitalValue;
+		for (int b = 0; b < 8; b++) {
+			outputs[BIT_OUTPUTS + b].setChannels(channels);
 			
-			int x = 0x01;
-			for (int b = 0; b < 8; b++) {
-				if (b < bits) {
-					bool q = (x == (digitalValue & x));
-					outs[b] = boolToGate(q);
-					lights[BIT_LIGHTS + b].setBrightness(boolToLight(q));
-					x = x << 1;
-				}
-				else {
-					outs[b] = 0.0f;
-					lights[BIT_LIGHTS + b].setBrightness(0.0f);
+			if (b < bits) {
+				int x = 1 << b;
+				for (int c = 0; c < channels; c++)
+					outputs[BIT_OUTPUTS + b].setVoltage(boolToGate(digitalValue[c] & x), c);
+			}
+			else {
+				for (int c = 0; c < channels; c++)
+					outputs[BIT_OUTPUTS + b].setVoltage(0.0f, c);
+			}
+		}
+		
+		// lights follow the first channel
+		if (prevValue != (digitalValue[0] & (int)fullScale)) {
+			prevValue = digitalValue[0] & (int)fullScale;
+			
+			for (int b = 0; b < 8; b++)
+				lights[BIT_LIGHTS + b].setBrightness(boolToLight(prevValue & (1 << b)));
+		}
+	}
+	
+	// convert all channels at the oversampled rate, 4 at a time, into oversampledCode
+	void processOversampled(int channels) {
+		for (int g = 0; g < (channels + 3) / 4; g++) {
+			simd::float_4 x[OVERSAMPLING_MAX];
+			x[0] = inputs[ANALOGUE_INPUT].getVoltageSimd<simd::float_4>(g * 4) * level;
+			
+			// each stage doubles the number of samples
+			for (int stage = 0, n = 1; stage < oversampleStages; stage++, n <<= 1) {
+				simd::float_4 in[OVERSAMPLING_MAX / 2];
+				for (int s = 0; s < n; s++)
+					in[s] = x[s];
+				
+				for (int s = 0; s < n; s++)
+					upsamplers[stage][g].process(in[s], &x[2 * s]);
+			}
+			
+			// quantise each sample
+			for (int s = 0; s < oversample; s++) {
+				simd::float_4 code = simd::clamp(x[s], 0.0f, vRef) * scale;
+				if (dither) {
+					code += simd::float_4(random::uniform() - random::uniform(), random::uniform() - random::uniform(),
+						random::uniform() - random::uniform(), random::uniform() - random::uniform());
 				}
+				
+				x[s] = simd::floor(simd::clamp(code, 0.0f, fullScale));
 			}
+			
+			// and filter the codes back down, each stage halving the number of samples
+			for (int stage = 0, n = oversample >> 1; stage < oversampleStages; stage++, n >>= 1) {
+				for (int s = 0; s < n; s++)
+					x[s] = decimators[stage][g].process(&x[2 * s]);
+			}
+			
+			simd::floor(simd::clamp(x[0] + 0.5f, 0.0f, fullScale)).store(&oversampledCode[g * 4]);
 		}
-
-		for (int b = 0; b < 8; b++)
-			outputs[BIT_OUTPUTS + b].setVoltage(outs[b]);
 	}
 };
 
@@ -139,7 +300,8 @@ struct ADCWidget : ModuleWidget {
 		addChild(createLightCentered<SmallLight<RedLight>>(Vec(STD_COLUMN_POSITIONS[STD_COL1], STD_HALF_ROWS8(STD_ROW2)), module, ADC::OL_LIGHT));
 		addParam(createParamCentered<Potentiometer<RedKnob>>(Vec(STD_COLUMN_POSITIONS[STD_COL1], STD_HALF_ROWS8(STD_ROW3)), module, ADC::LEVEL_PARAM));
 
-		// TODO: add a clock input ?
+		// clock input
+		addInput(createInputCentered<LunettaModulaLogicInputJack>(Vec(STD_COLUMN_POSITIONS[STD_COL1], STD_HALF_ROWS8(STD_ROW4) - 3), module, ADC::CLOCK_INPUT));
 
 		// converter section
 		addParam(createParamCentered<Potentiometer<RedKnob>>(Vec(STD_COLUMN_POSITIONS[STD_COL1], STD_HALF_ROWS8(STD_ROW5)), module, ADC::REFERENCE_PARAM));
@@ -156,10 +318,18 @@ struct ADCWidget : ModuleWidget {
 		
 	}
 	
+	// dither menu item
+	struct DitherMenuItem : MenuItem {
+		ADC *module;
+		
+		void onAction(const event::Action &e) override {
+			module->dither ^= true;
+		}
+	};
+	
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 	
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		ADC *module = dynamic_cast<ADC*>(this->module);
 		assert(module);
@@ -167,10 +337,14 @@ struct ADCWidget : ModuleWidget {
 		// blank separator
 		menu->addChild(new MenuSeparator());
 	
+		// add the dither menu item
+		DitherMenuItem *ditherMenuItem = createMenuItem<DitherMenuItem>("Dither", CHECKMARK(module->dither));
+		ditherMenuItem->module = module;
+		menu->addChild(ditherMenuItem);
+		
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}
-#endif
 };
 
 Model *modelADC = createModel<ADC, ADCWidget>("ADC");
@@ -9,6 +9,9 @@
 
 // used by mode management includes
 #define MODULE_NAME Binary8
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 struct Binary8 : Module {
 	enum ParamIds {
@@ -82,6 +85,11 @@ struct Binary8 : Module {
 	// table of full scale bits
 
 	void process(const ProcessArgs &args) override {
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
+
+	void processLogic(const ProcessArgs &args) {
 
 		// no point processing controls at audio rate
 		if (++processCount > 8) {
@@ -144,7 +152,6 @@ struct Binary8Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 	
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		Binary8 *module = dynamic_cast<Binary8*>(this->module);
 		assert(module);
@@ -155,7 +162,6 @@ struct Binary8Widget : ModuleWidget {
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}
-#endif
 	void step() override {
 		if (module) {
 			Binary8 *m = dynamic_cast<Binary8*>(this->module);
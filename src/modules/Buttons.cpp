@@ -9,6 +9,9 @@
 
 // used by mode management includes
 #define MODULE_NAME Buttons
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 #define NUM_GATES 6
 
@@ -112,6 +115,11 @@ struct Buttons : Module {
 	}	
 
 	void process(const ProcessArgs &args) override {
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
+
+	void processLogic(const ProcessArgs &args) {
 		
 		// process buttons
 		if (++processCount > 8) {
@@ -9,6 +9,9 @@
 
 // used by mode management includes
 #define MODULE_NAME CD4000
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 #define NUM_GATES 2
 
@@ -74,12 +77,12 @@ struct CD4000 : Module {
 	void setIOMode (int mode) {
 		// set CMOS input properties
 		for (int g = 0; g < NUM_GATES; g++) {
-			aInputs[g].setMode(mode);
-			bInputs[g].setMode(mode);
-			cInputs[g].setMode(mode);
+			aInputs[g].setThresholds(&thresholds);
+			bInputs[g].setThresholds(&thresholds);
+			cInputs[g].setThresholds(&thresholds);
 		}
 		
-		gInput.setMode(mode);
+		gInput.setThresholds(&thresholds);
 		
 		// set gate voltage
 		#include "../modes/setGateVoltage.hpp"
@@ -103,6 +106,11 @@ struct CD4000 : Module {
 	}	
 
 	void process(const ProcessArgs &args) override {
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
+
+	void processLogic(const ProcessArgs &args) {
 		
 		// process gates
 		for (int g = 0; g < NUM_GATES; g++) {
@@ -161,7 +169,6 @@ struct CD4000Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4000 *module = dynamic_cast<CD4000*>(this->module);
 		assert(module);
@@ -172,7 +179,6 @@ struct CD4000Widget : ModuleWidget {
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}	
-#endif	
 };
 
 Model *modelCD4000 = createModel<CD4000, CD4000Widget>("CD4000");
@@ -9,6 +9,9 @@
 
 // used by mode management includes
 #define MODULE_NAME CD4001
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 #define NUM_GATES 4
 
@@ -60,8 +63,8 @@ struct CD4001 : Module {
 		
 		// set CMOS input properties
 		for (int g = 0; g < NUM_GATES; g++) {
-			aInputs[g].setMode(mode);
-			bInputs[g].setMode(mode);
+			aInputs[g].setThresholds(&thresholds);
+			bInputs[g].setThresholds(&thresholds);
 		}
 		
 		// set gate voltage
@@ -86,6 +89,11 @@ struct CD4001 : Module {
 	}	
 
 	void process(const ProcessArgs &args) override {
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
+
+	void processLogic(const ProcessArgs &args) {
 		
 		for (int g = 0; g < NUM_GATES; g++) {
 
@@ -131,7 +139,6 @@ struct CD4001Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4001 *module = dynamic_cast<CD4001*>(this->module);
 		assert(module);
@@ -142,7 +149,6 @@ struct CD4001Widget : ModuleWidget {
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}
-#endif	
 };
 
 Model *modelCD4001 = createModel<CD4001, CD4001Widget>("CD4001");
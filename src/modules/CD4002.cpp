@@ -9,6 +9,9 @@
 
 // used by mode management includes
 #define MODULE_NAME CD4002
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 #define NUM_GATES 2
 
@@ -67,10 +70,10 @@ struct CD4002 : Module {
 	void setIOMode (int mode) {
 		// set CMOS input properties
 		for (int g = 0; g < NUM_GATES; g++) {
-			aInputs[g].setMode(mode);
-			bInputs[g].setMode(mode);
-			cInputs[g].setMode(mode);
-			dInputs[g].setMode(mode);
+			aInputs[g].setThresholds(&thresholds);
+			bInputs[g].setThresholds(&thresholds);
+			cInputs[g].setThresholds(&thresholds);
+			dInputs[g].setThresholds(&thresholds);
 		}
 		
 		// set gate voltage
@@ -95,6 +98,11 @@ struct CD4002 : Module {
 	}	
 	
 	void process(const ProcessArgs &args) override {
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
+
+	void processLogic(const ProcessArgs &args) {
 
 		// process gates
 		for (int g = 0; g < NUM_GATES; g++) {
@@ -144,7 +152,6 @@ struct CD4002Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4002 *module = dynamic_cast<CD4002*>(this->module);
 		assert(module);
@@ -155,7 +162,6 @@ struct CD4002Widget : ModuleWidget {
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}
-#endif	
 };
 
 Model *modelCD4002 = createModel<CD4002, CD4002Widget>("CD4002");
@@ -6,12 +6,19 @@
 #include "../LunettaModula.hpp"
 #include "../inc/Utility.hpp"
 #include "../inc/CMOSInput.hpp"
+#include "../inc/ExpanderCascade.hpp"
 
 // used by mode management includes
 #define MODULE_NAME CD4008
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 #define NUM_GATES 4
 
+// adjacent adders can be chained into a single adder of up to 32 bits
+#define MAX_CASCADE 8
+
 struct CD4008 : Module {
 	enum ParamIds {
 		NUM_PARAMS
@@ -40,8 +47,11 @@ struct CD4008 : Module {
 	CMOSInput bInputs[NUM_GATES];
 	CMOSInput carryInput;
 
-	const bool sumMap[8] = { false, true, true, false, true, false, false , true };
-	const bool carryMap[8] = {false, false, false, true, false, true, true, true };
+	// the sum and carry out as last written to the outputs, -1 forces them all to be rewritten
+	int prevOutputs = -1;
+	
+	// where we sit in the chain, worked out when a neighbour or the cascade option changes
+	CascadeState cascade;
 
 	CD4008() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
@@ -65,18 +75,23 @@ struct CD4008 : Module {
 		}
 		
 		carryInput.reset();
+		
+		prevOutputs = -1;
 	}
 
 	void setIOMode (int mode) {
 		
 		// set CMOS input properties
 		for (int g = 0; g < NUM_GATES; g++) {
-			aInputs[g].setMode(mode);
-			bInputs[g].setMode(mode);
+			aInputs[g].setThresholds(&thresholds);
+			bInputs[g].setThresholds(&thresholds);
 		}
 		
-		carryInput.setMode(mode);
+		carryInput.setThresholds(&thresholds);
 
+		// force the outputs to be rewritten at the new gate voltage
+		prevOutputs = -1;
+		
 		// set gate voltage
 		#include "../modes/setGateVoltage.hpp"
 	}
@@ -85,6 +100,7 @@ struct CD4008 : Module {
 		json_t *root = json_object();
 
 		json_object_set_new(root, "moduleVersion", json_integer(1));
+		json_object_set_new(root, "cascade", json_boolean(cascade.enabled));
 		
 		// add the I/O mode details
 		#include "../modes/dataToJson.hpp"		
@@ -94,42 +110,88 @@ struct CD4008 : Module {
 	
 	void dataFromJson(json_t *root) override {
 
+		json_t *jsonCascade = json_object_get(root, "cascade");
+		cascade.enabled = jsonCascade ? json_boolean_value(jsonCascade) : false;
+		cascade.changed = true;
+
 		// grab the I/O mode details
 		#include "../modes/dataFromJson.hpp"
 	}	
 
-	void process(const ProcessArgs &args) override {
+	static CascadeState *cascadeOf(Module *m) {
+		return (m && m->model == modelCD4008) ? &static_cast<CD4008*>(m)->cascade : NULL;
+	}
+	
+	void onExpanderChange(const ExpanderChangeEvent &e) override {
+		updateCascade(this, cascadeOf, MAX_CASCADE);
+	}
 
-		bool carry = carryInput.process(inputs[CARRY_INPUT].getVoltage());
+	void process(const ProcessArgs &args) override {
+		if (cascade.changed)
+			updateCascade(this, cascadeOf, MAX_CASCADE);
+		
+		// when we're part of a chain the adder at its head does all the work
+		if (cascade.offset > 0)
+			return;
+		
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
 
-		// process gates
-		for (int g = 0; g < NUM_GATES; g++) {
-			int i = aInputs[g].process(inputs[A_INPUTS + g].getVoltage()) ? 1 : 0;
-			i += bInputs[g].process(inputs[B_INPUTS + g].getVoltage()) ? 2 : 0;
-			i += carry ? 4 : 0;
+	void processLogic(const ProcessArgs &args) {
+
+		// gather the A and B inputs of the whole chain into words, A1/B1 of this adder being the least
+		// significant bits, so the addition is a single integer add with the carry resolved in the same sample
+		CD4008 *chain[MAX_CASCADE];
+		int n = 0;
+		uint64_t a = 0, b = 0;
+		for (Module *m = this; cascadeOf(m) && cascadeOf(m)->offset == n; m = m->rightExpander.module) {
+			CD4008 *adder = static_cast<CD4008*>(m);
+			a |= (uint64_t)adder->readWord(adder->aInputs, A_INPUTS) << (n * NUM_GATES);
+			b |= (uint64_t)adder->readWord(adder->bInputs, B_INPUTS) << (n * NUM_GATES);
+			chain[n++] = adder;
+		}
+		
+		uint64_t carryIn = carryInput.process(inputs[CARRY_INPUT].getVoltage()) ? 1 : 0;
+		uint64_t sum = a + b + carryIn;
+		
+		// the carry into each bit - the carry out of each adder is the carry into the next one's first bit
+		uint64_t carries = sum ^ a ^ b;
+		
+		for (int i = 0; i < n; i++) {
+			int bits = (int)((sum >> (i * NUM_GATES)) & 0x0F) | (int)(((carries >> ((i + 1) * NUM_GATES)) & 1) << NUM_GATES);
+			chain[i]->setOutputs(bits, alwaysWriteOutputs());
+		}
+	}
+	
+	int readWord(CMOSInput *bank, int firstInput) {
+		int word = 0;
+		for (int g = 0; g < NUM_GATES; g++)
+			word |= (bank[g].process(inputs[firstInput + g].getVoltage()) ? 1 : 0) << g;
 			
-			// process the addition for this bit using truth tables
-			bool q = sumMap[i];
-			carry = carryMap [i];
+		return word;
+	}
+	
+	// sum bits followed by the carry out, only written when they change
+	void setOutputs(int bits, bool force) {
+		int changed = force ? 0x1F : bits ^ prevOutputs;
+		if (changed == 0)
+			return;
 			
-			if (q) {
-				outputs[SUM_OUTPUTS + g].setVoltage(gateVoltage);
-				lights[SUM_LIGHTS + g].setBrightness(1.0f);
-			}
-			else {
-				outputs[SUM_OUTPUTS + g].setVoltage(0.0f);
-				lights[SUM_LIGHTS + g].setBrightness(0.0f);
+		prevOutputs = bits;
+		
+		for (int g = 0; g < NUM_GATES; g++) {
+			if ((changed >> g) & 1) {
+				bool q = (bits >> g) & 1;
+				outputs[SUM_OUTPUTS + g].setVoltage(boolToGate(q));
+				lights[SUM_LIGHTS + g].setBrightness(boolToLight(q));
 			}
 		}
 		
-		// process carry out
-		if (carry) {
-			outputs[CARRY_OUTPUT].setVoltage(gateVoltage);
-			lights[CO_LIGHT].setBrightness(1.0f);
-		}
-		else {
-			outputs[CARRY_OUTPUT].setVoltage(0.0f);
-			lights[CO_LIGHT].setBrightness(0.0f);
+		if ((changed >> NUM_GATES) & 1) {
+			bool carry = (bits >> NUM_GATES) & 1;
+			outputs[CARRY_OUTPUT].setVoltage(boolToGate(carry));
+			lights[CO_LIGHT].setBrightness(boolToLight(carry));
 		}
 	}
 };
@@ -165,7 +227,6 @@ struct CD4008Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4008 *module = dynamic_cast<CD4008*>(this->module);
 		assert(module);
@@ -173,10 +234,19 @@ struct CD4008Widget : ModuleWidget {
 		// blank separator
 		menu->addChild(new MenuSeparator());
 		
-		// add the I/O mode menu items
-		#include "../modes/modeMenus.hpp"
+		// add the cascade menu item
+		CascadeMenuItem *cascadeMenuItem = createMenuItem<CascadeMenuItem>("Cascade with left neighbour", CHECKMARK(module->cascade.enabled));
+		cascadeMenuItem->cascade = &module->cascade;
+		menu->addChild(cascadeMenuItem);
+		
+		// a chained adder is driven by the head of the chain so its own settings don't apply
+		if (module->cascade.offset > 0)
+			menu->addChild(createMenuLabel("Driven by the head of the chain"));
+		else {
+			// add the I/O mode menu items
+			#include "../modes/modeMenus.hpp"
+		}
 	}	
-#endif	
 };
 
 Model *modelCD4008 = createModel<CD4008, CD4008Widget>("CD4008");
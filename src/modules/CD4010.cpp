@@ -9,6 +9,9 @@
 
 // used by mode management includes
 #define MODULE_NAME CD4010
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 #define NUM_GATES 6
 
@@ -58,7 +61,7 @@ struct CD4010 : Module {
 		
 		// set CMOS input properties
 		for (int g = 0; g < NUM_GATES; g++) {
-			iInputs[g].setMode(mode);
+			iInputs[g].setThresholds(&thresholds);
 		}
 		
 		// set gate voltage
@@ -83,6 +86,11 @@ struct CD4010 : Module {
 	}	
 
 	void process(const ProcessArgs &args) override {
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
+
+	void processLogic(const ProcessArgs &args) {
 		
 		// process gates
 		for (int g = 0; g < NUM_GATES; g++) {
@@ -127,7 +135,6 @@ struct CD4010Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4010 *module = dynamic_cast<CD4010*>(this->module);
 		assert(module);
@@ -138,7 +145,6 @@ struct CD4010Widget : ModuleWidget {
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}
-#endif	
 };
 
 Model *modelCD4010 = createModel<CD4010, CD4010Widget>("CD4010");
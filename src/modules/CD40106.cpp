@@ -9,11 +9,15 @@
 
 // used by mode management includes
 #define MODULE_NAME CD40106
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 #define NUM_GATES 6
 
 struct CD40106 : Module {
 	enum ParamIds {
+		VDD_PARAM,
 		NUM_PARAMS
 	};
 	enum InputIds {
@@ -34,14 +38,26 @@ struct CD40106 : Module {
 	
 	CMOSInput iInputs[NUM_GATES];
 	
+	// supply voltage as last applied, the thresholds and gate voltage follow it
+	float vdd = VDD;
+	
+	void setVdd(float v) {
+		thresholds.setVdd(v);
+		vdd = thresholds.vdd;
+		gateVoltage = thresholds.gateVoltage;
+	}
+	
 	CD40106() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
-		setIOMode(CD40106_SCHMITT); // custom IO mode for this module based on the CD40106 datasheet
+		configParam(VDD_PARAM, VDD_MIN, VDD_MAX, VDD, "Vdd", " V");
+		
+		ioMode = CD40106_SCHMITT; // custom IO mode for this module based on the CD40106 datasheet
+		setIOMode(ioMode);
 		
 		char c = 'A';
 		for (int g = 0; g < NUM_GATES; g++) {
 			configInput(I_INPUTS + g, rack::string::f("Gate %d", g + 1));
-			inputInfos[I_INPUTS + g]->description = "Schmitt trigger input with thresholds at approx. 4.6 and 7 volts";
+			inputInfos[I_INPUTS + g]->description = "Schmitt trigger input with thresholds at approx. 38% and 58% of Vdd (4.6 and 7 volts at 12 volts)";
 			
 			configOutput(Q_OUTPUTS + g, rack::string::f("Gate %d %c (inverted)", g + 1, c++));
 		}
@@ -57,7 +73,7 @@ struct CD40106 : Module {
 		
 		// set CMOS input properties
 		for (int g = 0; g < NUM_GATES; g++) {
-			iInputs[g].setMode(mode);
+			iInputs[g].setThresholds(&thresholds);
 		}
 		
 		// set gate voltage
@@ -69,13 +85,31 @@ struct CD40106 : Module {
 
 		json_object_set_new(root, "moduleVersion", json_integer(1));
 
+		// add the I/O mode details
+		#include "../modes/dataToJson.hpp"
+
 		return root;
 	}
 	
-	// void dataFromJson(json_t *root) override {
-	// }	
+	void dataFromJson(json_t *root) override {
+		// grab the I/O mode details
+		#include "../modes/dataFromJson.hpp"
+
+		// the shared details assume the standard I/O mode, we always use our own
+		ioMode = CD40106_SCHMITT;
+		setIOMode(ioMode);
+	}	
 
 	void process(const ProcessArgs &args) override {
+		// the thresholds only need working out again when the supply voltage moves
+		if (params[VDD_PARAM].getValue() != vdd)
+			setVdd(params[VDD_PARAM].getValue());
+		
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
+
+	void processLogic(const ProcessArgs &args) {
 		// process gates
 		for (int g = 0; g < NUM_GATES; g++) {
 			bool q = !iInputs[g].process(inputs[I_INPUTS + g].getVoltage());
@@ -113,6 +147,26 @@ struct CD40106Widget : ModuleWidget {
 			addChild(createLightCentered<SmallLight<RedLight>>(Vec(STD_COLUMN_POSITIONS[STD_COL3] + 12, STD_ROWS6[STD_ROW1 + g] - 19), module, CD40106::Q_LIGHTS + g));
 		}
 	}	
+	
+	// include the I/O mode menu item structs we'll need when we add the mode menu items
+	#include "../modes/modeMenuItem.hpp"
+
+	void appendContextMenu(Menu *menu) override {
+		CD40106 *module = dynamic_cast<CD40106*>(this->module);
+		assert(module);
+
+		// blank separator
+		menu->addChild(new MenuSeparator());
+	
+		// the CD40106 always uses CMOS levels so the supply voltage is always available
+		ui::Slider *vddSlider = new ui::Slider;
+		vddSlider->quantity = module->paramQuantities[CD40106::VDD_PARAM];
+		vddSlider->box.size.x = 200.0f;
+		menu->addChild(vddSlider);
+		
+		// add the I/O mode menu items
+		#include "../modes/modeMenus.hpp"
+	}
 };
 
 Model *modelCD40106 = createModel<CD40106, CD40106Widget>("CD40106");
@@ -9,6 +9,9 @@
 
 // used by mode management includes
 #define MODULE_NAME CD4012
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 #define NUM_GATES 2
 
@@ -79,10 +82,10 @@ struct CD4012 : Module {
 		
 		// set CMOS input properties
 		for (int g = 0; g < NUM_GATES; g++) {
-			aInputs[g].setMode(mode);
-			bInputs[g].setMode(mode);
-			cInputs[g].setMode(mode);
-			dInputs[g].setMode(mode);
+			aInputs[g].setThresholds(&thresholds);
+			bInputs[g].setThresholds(&thresholds);
+			cInputs[g].setThresholds(&thresholds);
+			dInputs[g].setThresholds(&thresholds);
 		}
 		
 		// set gate voltage
@@ -96,6 +99,11 @@ struct CD4012 : Module {
 	}	
 
 	void process(const ProcessArgs &args) override {
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
+
+	void processLogic(const ProcessArgs &args) {
 		
 		// process gates
 		for (int g = 0; g < NUM_GATES; g++) {
@@ -145,7 +153,6 @@ struct CD4012Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4012 *module = dynamic_cast<CD4012*>(this->module);
 		assert(module);
@@ -156,7 +163,6 @@ struct CD4012Widget : ModuleWidget {
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}
-#endif	
 };
 
 Model *modelCD4012 = createModel<CD4012, CD4012Widget>("CD4012");
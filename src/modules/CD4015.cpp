@@ -6,9 +6,14 @@
 #include "../LunettaModula.hpp"
 #include "../inc/Utility.hpp"
 #include "../inc/CMOSInput.hpp"
+#include "../inc/LogicOversampler.hpp"
 
 // used by mode management includes
 #define MODULE_NAME CD4015
+#define LOGIC_OVERSAMPLING
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 #define NUM_GATES 2
 
@@ -31,31 +36,41 @@ struct CD4015 : Module {
 		NUM_LIGHTS
 	};
 	
+	// 4 stage shift register for all channels at once, each stage holding one bit per channel
 	struct TappedShiftRegister {
-		bool bits[4] = {};
+		int bits[4] = {};
 		
-		void process(bool newValue) {
-			bits[3] = bits[2];
-			bits[2] = bits[1];
-			bits[1] = bits[0];
-			bits[0] = newValue;
+		// shift the given channels along, inserting the new data in the first stage
+		void process(int newValue, int channels) {
+			bits[3] = (bits[3] & ~channels) | (bits[2] & channels);
+			bits[2] = (bits[2] & ~channels) | (bits[1] & channels);
+			bits[1] = (bits[1] & ~channels) | (bits[0] & channels);
+			bits[0] = (bits[0] & ~channels) | (newValue & channels);
 		}
 		
-		void reset () {
+		void reset(int channels) {
 			for (int i = 0; i < 4; i++)
-				bits[i] = false;
+				bits[i] &= ~channels;
 		}
 	};	
 		
 	// add the variables we'll use when managing modes
 	#include "../modes/modeVariables.hpp"
 	
-	CMOSInput dataInputs[NUM_GATES];
-	CMOSInput resetInputs[NUM_GATES];
-	CMOSInput clockInputs[NUM_GATES];
+	CMOSPolyInput dataInputs[NUM_GATES];
+	CMOSPolyInput resetInputs[NUM_GATES];
+	CMOSPolyInput clockInputs[NUM_GATES];
 	
-	TappedShiftRegister shiftReg[NUM_INPUTS];
-	bool reset = false;
+	TappedShiftRegister shiftReg[NUM_GATES];
+	
+	// the clock of each channel as last seen outside of reset
+	int clocks[NUM_GATES] = {};
+	
+	// the stages as last written to the outputs
+	int prevBits[NUM_GATES][4] = {};
+	
+	// the number of channels last written, 0 forces them all to be rewritten
+	int prevChannels = 0;
 	
 	CD4015() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
@@ -72,8 +87,6 @@ struct CD4015 : Module {
 		}
 				
 		setIOMode(VCVRACK_STANDARD);
-		
-		reset = false;
 	}
 	
 	void onReset() override {
@@ -82,19 +95,25 @@ struct CD4015 : Module {
 			resetInputs[g].reset();
 			clockInputs[g].reset();
 			
-			shiftReg[g].reset();
+			shiftReg[g].reset(0xFFFF);
+			clocks[g] = 0;
 		}
+		
+		prevChannels = 0;
 	}
 
 	void setIOMode (int mode) {
 		
 		// set CMOS input properties
 		for (int g = 0; g < NUM_GATES; g++) {
-			dataInputs[g].setMode(mode);
-			resetInputs[g].setMode(mode);
-			clockInputs[g].setMode(mode);
+			dataInputs[g].setThresholds(&thresholds);
+			resetInputs[g].setThresholds(&thresholds);
+			clockInputs[g].setThresholds(&thresholds);
 		}
 		
+		// force the outputs to be rewritten at the new gate voltage
+		prevChannels = 0;
+		
 		// set gate voltage
 		#include "../modes/setGateVoltage.hpp"
 	}
@@ -117,52 +136,46 @@ struct CD4015 : Module {
 	}	
 
 	void process(const ProcessArgs &args) override {
+		// run the logic at the selected rate and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
+
+	void processLogic(const ProcessArgs &args) {
 	
-		int qOffset = 0;
+		int channels = 1;
+		for (int i = 0; i < NUM_INPUTS; i++)
+			channels = std::max(channels, inputs[i].getChannels());
+		
+		bool force = alwaysWriteOutputs() || channels != prevChannels;
+		prevChannels = channels;
 
 		for (int g = 0; g < NUM_GATES; g++) {
-			bool change = false;
+			int data = dataInputs[g].process(inputs[DATA_INPUTS + g], channels);
+			int clock = clockInputs[g].process(inputs[CLOCK_INPUTS + g], channels);
 			
-			// process the current shift register
-			if (resetInputs[g].process(inputs[RESET_INPUTS + g].getVoltage())) {
-				// reset holds all outputs low
-				shiftReg[g].reset();
-				
-				if (!reset)
-					change = true;
-					
-				reset = true;
-			}
-			else {
-				// process clock
-				bool prevClock = clockInputs[g].isHigh();
-				bool clock = clockInputs[g].process(inputs[CLOCK_INPUTS + g].getVoltage());
-
-				// leading clock edge shifts the data and insert the new data
-				if (clock & !prevClock) {
-					shiftReg[g].process(dataInputs[g].process(inputs[DATA_INPUTS + g].getVoltage()));
-					change = true;
-					reset = false;
-				}
-			}
+			// reset holds all outputs low, the clock being ignored until it is released
+			int reset = resetInputs[g].process(inputs[RESET_INPUTS + g], channels);
+			shiftReg[g].reset(reset);
+			
+			// leading clock edge shifts the data and insert the new data
+			int edges = clock & ~clocks[g] & ~reset;
+			clocks[g] = (clock & ~reset) | (clocks[g] & reset);
+			
+			if (edges)
+				shiftReg[g].process(data, edges);
 			
 			// process the outputs
-			int out = Q_OUTPUTS + qOffset;
-			int led = Q_LIGHTS + qOffset;
 			for (int i = 0; i < 4; i++) {
-				if (shiftReg[g].bits[i]) {
-					outputs[out++].setVoltage(gateVoltage);
-					if (change)
-						lights[led].setBrightness(1.0f);
-				}
-				else {
-					outputs[out++].setVoltage(0.0f);
-					if (change)
-						lights[led].setBrightness(0.0f);
+				int bits = shiftReg[g].bits[i];
+				if (force || bits != prevBits[g][i]) {
+					prevBits[g][i] = bits;
+					
+					setChannelGates(outputs[Q_OUTPUTS + (g * 4) + i], bits, channels, gateVoltage);
+					
+					// lights show the first channel
+					lights[Q_LIGHTS + (g * 4) + i].setBrightness(boolToLight(bits & 1));
 				}
-				led++;
 			}
-			qOffset += 4;
 		}
 	}
 };
@@ -194,7 +207,6 @@ struct CD4015Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4015 *module = dynamic_cast<CD4015*>(this->module);
 		assert(module);
@@ -205,7 +217,6 @@ struct CD4015Widget : ModuleWidget {
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}
-#endif	
 };
 
 Model *modelCD4015 = createModel<CD4015, CD4015Widget>("CD4015");
@@ -6,9 +6,14 @@
 #include "../LunettaModula.hpp"
 #include "../inc/Utility.hpp"
 #include "../inc/CMOSInput.hpp"
+#include "../inc/LogicOversampler.hpp"
 
 // used by mode management includes
 #define MODULE_NAME CD4017
+#define LOGIC_OVERSAMPLING
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 #define MAX_COUNT 10
 #define CARRY_COUNT 5
@@ -37,14 +42,20 @@ struct CD4017 : Module {
 	// add the variables we'll use when managing modes
 	#include "../modes/modeVariables.hpp"
 	
-	CMOSInput clockInput;
-	CMOSInput inhibitInput;
-	CMOSInput resetInput;
+	// state of each input for each group of 4 channels as SIMD masks
+	simd::float_4 inputStates[NUM_INPUTS][PORT_MAX_CHANNELS / 4];
 	
-	int count = 0;
-	bool reset = false;
-	bool carry = false;
-	bool update = false;
+	// count of each channel packed 4 bits to a channel, the first channel in the lowest bits
+	uint64_t counts = 0;
+	uint64_t prevCounts = 0;
+	
+	// carry, and clock as last seen while enabled, of each channel packed 1 bit to a channel
+	int carries = 0;
+	int prevCarries = 0;
+	int clocks = 0;
+	
+	// the number of channels last written, 0 forces them all to be rewritten
+	int prevChannels = 0;
 	
 	CD4017() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
@@ -60,28 +71,28 @@ struct CD4017 : Module {
 			
 		configOutput(CARRY_OUTPUT, "Carry");
 		
+		onReset();
+		
 		setIOMode(VCVRACK_STANDARD);
-		count = 0;
-		reset = false;
-		carry = false;
-		update = true;
 	}
 	
 	void onReset() override {
-		clockInput.reset();
-		inhibitInput.reset();
-		resetInput.reset();
-
-		count = 0;
-		carry = false;
-		reset = false;
-		update = true;
+		for (int i = 0; i < NUM_INPUTS; i++) {
+			for (int g = 0; g < PORT_MAX_CHANNELS / 4; g++)
+				inputStates[i][g] = simd::float_4::zero();
+		}
+
+		counts = 0;
+		carries = 0;
+		clocks = 0;
+		prevChannels = 0;
 	}
 
 	void setIOMode (int mode) {
-		clockInput.setMode(mode);
-		inhibitInput.setMode(mode);
-		resetInput.setMode(mode);
+		// the inputs are modelled in the logic using the module's thresholds
+		
+		// force the outputs to be rewritten at the new gate voltage
+		prevChannels = 0;
 		
 		// set gate voltage
 		#include "../modes/setGateVoltage.hpp"
@@ -105,66 +116,127 @@ struct CD4017 : Module {
 	}	
 
 	void process(const ProcessArgs &args) override {
+		// run the logic at the selected rate and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
 
-		// are we reset?
-		if (resetInput.process(inputs[RESET_INPUT].getVoltage())) {
-			count = 0;
-			carry = false;
-			
-			if (!reset)
-				update = true;
-				
-			reset = true;
+	void processLogic(const ProcessArgs &args) {
+
+		int channels = 1;
+		for (int i = 0; i < NUM_INPUTS; i++)
+			channels = std::max(channels, inputs[i].getChannels());
+		
+		simd::float_4 vLow = thresholds.vLow;
+		simd::float_4 vHigh = thresholds.vHigh;
+		
+		// gather the state of each input into a word with a bit per channel
+		int states[NUM_INPUTS] = {};
+		for (int c = 0; c < channels; c += 4) {
+			int g = c >> 2;
+			for (int i = 0; i < NUM_INPUTS; i++) {
+				simd::float_4 v = inputs[i].getPolyVoltageSimd<simd::float_4>(c);
+				inputStates[i][g] = simd::ifelse(inputStates[i][g], v > vLow, v >= vHigh);
+				states[i] |= simd::movemask(inputStates[i][g]) << c;
+			}
 		}
-		else {
-			// process the clock
-			bool prevClock = clockInput.isHigh();
-			bool enable = !inhibitInput.process(inputs[INHIBIT_INPUT].getVoltage());
-			bool clock = enable && clockInput.process(inputs[CLOCK_INPUT].getVoltage());
+		
+		int channelMask = (1 << channels) - 1;
+		int resets = states[RESET_INPUT] & channelMask;
+		
+		// the clock is ignored while reset or inhibited, so it holds the state it was in beforehand
+		int enabled = ~(resets | states[INHIBIT_INPUT]) & channelMask;
+		int edges = states[CLOCK_INPUT] & enabled & ~clocks;
+		clocks = (states[CLOCK_INPUT] & enabled) | (clocks & ~enabled);
+		
+		// only the channels being reset or clocked need to be looked at
+		int active = resets | edges;
+		while (active) {
+			int c = __builtin_ctz(active);
+			active &= active - 1;
 			
-			if (!prevClock && clock) {
+			int shift = c * 4;
+			int count = 0;
+			int carry = 0;
+			if ((resets >> c) & 1) {
+				count = 0;
+				carry = 0;
+			}
+			else {
+				count = (int)((counts >> shift) & 0x0F);
+				carry = (carries >> c) & 1;
+				
 				if (++count >= MAX_COUNT) {
-					carry = true;
+					carry = 1;
 					count = 0;
 				}
 				else if (count >= CARRY_COUNT)
-					carry = false;
-					
-				update = true;
-				reset = false;
+					carry = 0;
 			}
+			
+			counts = (counts & ~((uint64_t)0x0F << shift)) | ((uint64_t)count << shift);
+			carries = (carries & ~(1 << c)) | (carry << c);
 		}
 		
-		// decode the outputs
-		int out = DECODED_OUTPUTS;
-		int led = DECODED_LIGHTS;
-		
-		for (int i = 0; i < MAX_COUNT; i++) {
-			bool q = (i == count);
-			if (q) {
-				outputs[out++].setVoltage(gateVoltage);
-				if (update)
-					lights[led++].setBrightness(1.0f);
+		// write the outputs
+		if (channels != prevChannels || alwaysWriteOutputs()) {
+			for (int i = 0; i < MAX_COUNT; i++)
+				outputs[DECODED_OUTPUTS + i].setChannels(channels);
+			
+			outputs[CARRY_OUTPUT].setChannels(channels);
+			
+			for (int c = 0; c < channels; c++)
+				setOutputs(c, -1, true);
+			
+			prevChannels = channels;
+		}
+		else {
+			// only the channels whose count or carry has changed, and only the outputs that change on them
+			int changed = carries ^ prevCarries;
+			uint64_t changedCounts = counts ^ prevCounts;
+			for (int c = 0; c < channels; c++) {
+				if ((changedCounts >> (c * 4)) & 0x0F)
+					changed |= 1 << c;
 			}
-			else {
-				outputs[out++].setVoltage(0.0f);
-				if (update)
-					lights[led++].setBrightness(0.0f);
+			
+			while (changed) {
+				int c = __builtin_ctz(changed);
+				changed &= changed - 1;
+				
+				setOutputs(c, (int)((prevCounts >> (c * 4)) & 0x0F), false);
 			}
 		}
-
-		if(carry) {
-			outputs[CARRY_OUTPUT].setVoltage(gateVoltage);
-			if (update)
-				lights[CARRY_LIGHT].setBrightness(1.0f);
-		}
-		else {
-			outputs[CARRY_OUTPUT].setVoltage(0.0f);
-			if (update)
-				lights[CARRY_LIGHT].setBrightness(0.0f);
+		
+		prevCounts = counts;
+		prevCarries = carries;
+	}
+	
+	// set the decoded and carry outputs of a channel, clearing the previous decoded output or all of them when forced
+	void setOutputs(int c, int prevCount, bool force) {
+		int count = (int)((counts >> (c * 4)) & 0x0F);
+		bool carry = (carries >> c) & 1;
+		
+		if (force) {
+			for (int i = 0; i < MAX_COUNT; i++)
+				outputs[DECODED_OUTPUTS + i].setVoltage(0.0f, c);
 		}
+		else
+			outputs[DECODED_OUTPUTS + prevCount].setVoltage(0.0f, c);
+		
+		outputs[DECODED_OUTPUTS + count].setVoltage(gateVoltage, c);
+		outputs[CARRY_OUTPUT].setVoltage(boolToGate(carry), c);
 		
-		update = false;
+		// lights show the first channel
+		if (c == 0) {
+			if (force) {
+				for (int i = 0; i < MAX_COUNT; i++)
+					lights[DECODED_LIGHTS + i].setBrightness(0.0f);
+			}
+			else
+				lights[DECODED_LIGHTS + prevCount].setBrightness(0.0f);
+			
+			lights[DECODED_LIGHTS + count].setBrightness(1.0f);
+			lights[CARRY_LIGHT].setBrightness(boolToLight(carry));
+		}
 	}
 };
 
@@ -202,7 +274,6 @@ struct CD4017Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4017 *module = dynamic_cast<CD4017*>(this->module);
 		assert(module);
@@ -213,7 +284,6 @@ struct CD4017Widget : ModuleWidget {
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}	
-#endif	
 };
 
 Model *modelCD4017 = createModel<CD4017, CD4017Widget>("CD4017");
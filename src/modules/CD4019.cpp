@@ -9,6 +9,9 @@
 
 // used by mode management includes
 #define MODULE_NAME CD4019
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 #define NUM_GATES 4
 
@@ -36,10 +39,15 @@ struct CD4019 : Module {
 	// add the variables we'll use when managing modes
 	#include "../modes/modeVariables.hpp"
 	
-	CMOSInput aInputs[NUM_GATES];
-	CMOSInput bInputs[NUM_GATES];
-	CMOSInput kaInput;
-	CMOSInput kbInput;
+	// the A, B and select inputs of each channel
+	CMOSInputBank channelInputs[PORT_MAX_CHANNELS];
+	float voltages[CMOS_INPUT_BANK_MAX] = {};
+	
+	// the outputs of each channel as last written
+	int prevOutputs[PORT_MAX_CHANNELS] = {};
+	
+	// the number of channels last written, 0 forces them all to be rewritten
+	int prevChannels = 0;
 	
 	int prevSelect = -1;
 	
@@ -55,31 +63,27 @@ struct CD4019 : Module {
 		configInput(KA_INPUT, "KA");
 		configInput(KB_INPUT, "KB");
 
-		
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++)
+			channelInputs[c] = CMOSInputBank(NUM_INPUTS);
 		
 		setIOMode(VCVRACK_STANDARD);
 	}
 	
 	void onReset() override {
-		for (int g = 0; g < NUM_GATES; g++) {
-			aInputs[g].reset();
-			bInputs[g].reset();
-		}
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++)
+			channelInputs[c].reset();
 		
-		kaInput.reset();
-		kbInput.reset();
+		prevChannels = 0;
 	}
 
 	void setIOMode (int mode) {
 		
 		// set CMOS input properties
-		for (int g = 0; g < NUM_GATES; g++) {
-			aInputs[g].setMode(mode);
-			bInputs[g].setMode(mode);
-		}
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++)
+			channelInputs[c].setThresholds(&thresholds);
 		
-		kaInput.setMode(mode);
-		kbInput.setMode(mode);
+		// force the outputs to be rewritten at the new gate voltage
+		prevChannels = 0;
 		
 		// set gate voltage
 		#include "../modes/setGateVoltage.hpp"
@@ -103,53 +107,69 @@ struct CD4019 : Module {
 	}	
 
 	void process(const ProcessArgs &args) override {
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
+
+	void processLogic(const ProcessArgs &args) {
 		
-		// process select function
-		int select = (kaInput.process(inputs[KA_INPUT].getVoltage()) ? 0x01 : 0x00);
-		select += (kbInput.process(inputs[KB_INPUT].getVoltage()) ? 0x02: 0x00);
+		int channels = 1;
+		for (int i = 0; i < NUM_INPUTS; i++)
+			channels = std::max(channels, inputs[i].getChannels());
 		
-		// process gates
-		int out = Q_OUTPUTS;
-		int led = Q_LIGHTS;
-		int aIn = A_INPUTS;
-		int bIn = B_INPUTS;
-		for (int g = 0; g < NUM_GATES; g++) {
-			bool a = aInputs[g].process(inputs[aIn++].getVoltage());
-			bool b = bInputs[g].process(inputs[bIn++].getVoltage()); 
-
-			bool q = false;
-			switch (select) {
-				case 0: // Always low
-					break;
-				case 1: // A input
-					q = a;
-					break;
-				case 2: // B Input
-					q = b;
-					break;
-				case 3: // OR function
-					q = a || b;
-					break;
-			}
-
-			if (q) {
-				outputs[out++].setVoltage(gateVoltage);
-				lights[led++].setBrightness(1.0f);
-			}
-			else {
-				outputs[out++].setVoltage(0.0f);
-				lights[led++].setBrightness(0.0f);
-			}
+		bool force = alwaysWriteOutputs();
+		if (channels != prevChannels) {
+			for (int g = 0; g < NUM_GATES; g++)
+				outputs[Q_OUTPUTS + g].setChannels(channels);
+			
+			prevChannels = channels;
+			force = true;
 		}
-
-		// show status
-		if (select != prevSelect) {
-			int j = 1;
+		
+		for (int c = 0; c < channels; c++) {
+			// the input ids are already in the order of the bits in the word
+			for (int i = 0; i < NUM_INPUTS; i++)
+				voltages[i] = inputs[i].getPolyVoltage(c);
+			
+			int word = channelInputs[c].process(voltages);
 			
-			prevSelect = select;
+			// KA selects the A inputs and KB the B inputs, both giving the OR of the two and neither giving all low
+			int kaMask = -((word >> KA_INPUT) & 1);
+			int kbMask = -((word >> KB_INPUT) & 1);
+			int q = ((word & kaMask) | ((word >> B_INPUTS) & kbMask)) & 0x0F;
 			
-			for (int i = 0; i < 3; i++)
-				lights[STATUS_LIGHTS + i].setBrightness(boolToLight(j++ == select));
+			setOutputs(c, q, force);
+			
+			// show status
+			int select = (word >> KA_INPUT) & 0x03;
+			if (c == 0 && select != prevSelect) {
+				int j = 1;
+				
+				prevSelect = select;
+				
+				for (int i = 0; i < 3; i++)
+					lights[STATUS_LIGHTS + i].setBrightness(boolToLight(j++ == select));
+			}
+		}
+	}
+	
+	// only the outputs that change are written
+	void setOutputs(int c, int q, bool force) {
+		int changed = force ? 0x0F : q ^ prevOutputs[c];
+		if (changed == 0)
+			return;
+		
+		prevOutputs[c] = q;
+		
+		for (int g = 0; g < NUM_GATES; g++) {
+			if ((changed >> g) & 1) {
+				bool out = (q >> g) & 1;
+				outputs[Q_OUTPUTS + g].setVoltage(boolToGate(out), c);
+				
+				// lights show the first channel
+				if (c == 0)
+					lights[Q_LIGHTS + g].setBrightness(boolToLight(out));
+			}
 		}
 	}
 };
@@ -189,7 +209,6 @@ struct CD4019Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4019 *module = dynamic_cast<CD4019*>(this->module);
 		assert(module);
@@ -200,7 +219,6 @@ struct CD4019Widget : ModuleWidget {
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}	
-#endif	
 };
 
 Model *modelCD4019 = createModel<CD4019, CD4019Widget>("CD4019");
@@ -9,6 +9,9 @@
 
 // used by mode management includes
 #define MODULE_NAME CD4023
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 #define NUM_GATES 3
 
@@ -64,9 +67,9 @@ struct CD4023 : Module {
 		
 		// set CMOS input properties
 		for (int g = 0; g < NUM_GATES; g++) {
-			aInputs[g].setMode(mode);
-			bInputs[g].setMode(mode);
-			cInputs[g].setMode(mode);
+			aInputs[g].setThresholds(&thresholds);
+			bInputs[g].setThresholds(&thresholds);
+			cInputs[g].setThresholds(&thresholds);
 		}
 		
 		// set gate voltage
@@ -91,6 +94,11 @@ struct CD4023 : Module {
 	}	
 
 	void process(const ProcessArgs &args) override {
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
+
+	void processLogic(const ProcessArgs &args) {
 		
 		for (int g = 0; g < NUM_GATES; g++) {
 			bool q = aInputs[g].process(inputs[A_INPUTS + g].getVoltage())
@@ -138,7 +146,6 @@ struct CD4023Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4023 *module = dynamic_cast<CD4023*>(this->module);
 		assert(module);
@@ -149,7 +156,6 @@ struct CD4023Widget : ModuleWidget {
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}
-#endif	
 };
 
 Model *modelCD4023 = createModel<CD4023, CD4023Widget>("CD4023");
@@ -6,12 +6,21 @@
 #include "../LunettaModula.hpp"
 #include "../inc/Utility.hpp"
 #include "../inc/CMOSInput.hpp"
+#include "../inc/LogicOversampler.hpp"
 
 // used by mode management includes
 #define MODULE_NAME CD4031
+#define LOGIC_OVERSAMPLING
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
+
+#define MAX_LENGTH 64
+#define NUM_TAPS 8
 
 struct CD4031 : Module {
 	enum ParamIds {
+		LENGTH_PARAM,
 		NUM_PARAMS
 	};
 	enum InputIds {
@@ -19,12 +28,14 @@ struct CD4031 : Module {
 		CLOCK_INPUT,
 		RECIRC_INPUT,
 		MODE_INPUT,
+		LENGTH_INPUT,
 		NUM_INPUTS
 	};
 	enum OutputIds {
 		DEL_CLOCK_OUTPUT,
 		Q_OUTPUT,
 		NQ_OUTPUT,
+		TAP_OUTPUT,
 		NUM_OUTPUTS
 	};
 	enum LightIds {
@@ -46,23 +57,32 @@ struct CD4031 : Module {
 	
 	bool delayedClock[2] = {};
 	
-	bool shiftRegister[64] = {};
-	unsigned int in = 63;
-	unsigned int out = 0;
+	// stage 1 is the least significant bit
+	uint64_t shiftRegister = 0;
+	
+	// the state of the taps when last written
+	uint64_t prevTaps = ~0;
 	
 	CD4031() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
 		
+		configParam(LENGTH_PARAM, 1.0f, (float)MAX_LENGTH, (float)MAX_LENGTH, "Length", " stages");
+		paramQuantities[LENGTH_PARAM]->snapEnabled = true;
+		
 		configInput(DATA_INPUT, "Data");
 		configInput(CLOCK_INPUT, "Clock");
 		configInput(RECIRC_INPUT, "Recirculate");
 		configInput(MODE_INPUT, "Mode");
 		inputInfos[MODE_INPUT]->description = "Low to select data input, high to select recirculate input";
+		configInput(LENGTH_INPUT, "Length CV");
+		inputInfos[LENGTH_INPUT]->description = "Adds 6.4 stages per volt to the length";
 		
 		configOutput(DEL_CLOCK_OUTPUT, "Delayed clock");
 		outputInfos[DEL_CLOCK_OUTPUT]->description = "Clock delayed by 1 sample";
 		configOutput(Q_OUTPUT, "Q");
 		configOutput(NQ_OUTPUT, "Not Q");
+		configOutput(TAP_OUTPUT, "Taps");
+		outputInfos[TAP_OUTPUT]->description = "Polyphonic, stages 1 to 8 on channels 1 to 8";
 		
 		setIOMode(VCVRACK_STANDARD);
 	}
@@ -75,16 +95,19 @@ struct CD4031 : Module {
 		
 		delayedClock[0] = delayedClock[1] = false;
 		
-		for (int i = 0; i < 64; i++)
-			shiftRegister[i] = false;
+		shiftRegister = 0;
+		prevTaps = ~0;
 	}
 	
 	void setIOMode (int mode) {
 		// set CMOS input properties
-		dataInput.setMode(mode);
-		clockInput.setMode(mode);
-		recircInput.setMode(mode);
-		modeInput.setMode(mode);
+		dataInput.setThresholds(&thresholds);
+		clockInput.setThresholds(&thresholds);
+		recircInput.setThresholds(&thresholds);
+		modeInput.setThresholds(&thresholds);
+		
+		// force the taps to be rewritten at the new gate voltage
+		prevTaps = ~0;
 		
 		// set gate voltage
 		#include "../modes/setGateVoltage.hpp"
@@ -108,6 +131,11 @@ struct CD4031 : Module {
 	}	
 
 	void process(const ProcessArgs &args) override {
+		// run the logic at the selected rate and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
+
+	void processLogic(const ProcessArgs &args) {
 		
 		// what mode are we in?
 		bool recircMode = modeInput.process(inputs[MODE_INPUT].getVoltage());
@@ -144,17 +172,27 @@ struct CD4031 : Module {
 		}
 		
 		// process the shift register here
-		if (edge) {
-			shiftRegister[in++]= data;
-			if (in > 63)
-				in = 0;
-			
-			if (++out > 63)
-					out = 0;
-		}
+		if (edge)
+			shiftRegister = (shiftRegister << 1) | (data ? 1 : 0);
 
+		// the output stage depends on the selected length
+		int length = clamp((int)(params[LENGTH_PARAM].getValue() + inputs[LENGTH_INPUT].getVoltage() * 6.4f), 1, MAX_LENGTH);
+		
+		// tap outputs - only written when they change
+		if (outputs[TAP_OUTPUT].isConnected()) {
+			uint64_t taps = shiftRegister & 0xFF;
+			if (taps != prevTaps || alwaysWriteOutputs()) {
+				prevTaps = taps;
+				outputs[TAP_OUTPUT].setChannels(NUM_TAPS);
+				for (int t = 0; t < NUM_TAPS; t++)
+					outputs[TAP_OUTPUT].setVoltage(boolToGate((taps >> t) & 1), t);
+			}
+		}
+		else
+			prevTaps = ~0;
+		
 		// data outputs
-		if (shiftRegister[out]) {
+		if ((shiftRegister >> (length - 1)) & 1) {
 			outputs[Q_OUTPUT].setVoltage(gateVoltage);
 			lights[Q_LIGHT].setBrightness(1.0f);
 			outputs[NQ_OUTPUT].setVoltage(0.0f);
@@ -197,12 +235,15 @@ struct CD4031Widget : ModuleWidget {
 		addChild(createLightCentered<SmallLight<RedLight>>(Vec(STD_COLUMN_POSITIONS[STD_COL1] + 12, STD_ROWS5[STD_ROW5] - 19), module, CD4031::Q_LIGHT));
 		addOutput(createOutputCentered<LunettaModulaLogicOutputJack>(Vec(STD_COLUMN_POSITIONS[STD_COL3], STD_ROWS5[STD_ROW5]), module, CD4031::NQ_OUTPUT));
 		addChild(createLightCentered<SmallLight<RedLight>>(Vec(STD_COLUMN_POSITIONS[STD_COL3] + 12, STD_ROWS5[STD_ROW5] - 19), module, CD4031::NQ_LIGHT));
+		
+		// length CV and tap outputs
+		addInput(createInputCentered<LunettaModulaAnalogInputJack>(Vec(STD_COLUMN_POSITIONS[STD_COL1], STD_ROWS5[STD_ROW3]), module, CD4031::LENGTH_INPUT));
+		addOutput(createOutputCentered<LunettaModulaLogicOutputJack>(Vec(STD_COLUMN_POSITIONS[STD_COL3], STD_ROWS5[STD_ROW3]), module, CD4031::TAP_OUTPUT));
 	}
 
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4031 *module = dynamic_cast<CD4031*>(this->module);
 		assert(module);
@@ -210,10 +251,15 @@ struct CD4031Widget : ModuleWidget {
 		// blank separator
 		menu->addChild(new MenuSeparator());
 		
+		// the length has no room on the panel so it lives here
+		ui::Slider *lengthSlider = new ui::Slider;
+		lengthSlider->quantity = module->paramQuantities[CD4031::LENGTH_PARAM];
+		lengthSlider->box.size.x = 200.0f;
+		menu->addChild(lengthSlider);
+		
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}	
-#endif	
 };
 
 Model *modelCD4031 = createModel<CD4031, CD4031Widget>("CD4031");
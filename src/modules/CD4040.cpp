@@ -6,15 +6,19 @@
 #include "../LunettaModula.hpp"
 #include "../inc/Utility.hpp"
 #include "../inc/CMOSInput.hpp"
+#include "../inc/LogicOversampler.hpp"
+#include "../inc/CounterCascade.hpp"
 
 // used by mode management includes
 #define MODULE_NAME CD4040
+#define LOGIC_OVERSAMPLING
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
-#define MAX_COUNT 4096
 #define NUM_BITS 12
-#define NUM_BITS_PLUS_1 13
 
-struct CD4040 : Module {
+struct CD4040 : CascadableCounter {
 	enum ParamIds {
 		NUM_PARAMS
 	};
@@ -40,15 +44,14 @@ struct CD4040 : Module {
 	CMOSInput clockInput;
 	CMOSInput resetInput;
 	
-	const int bitmap[NUM_BITS_PLUS_1] = { 0, 1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048 };
 	const int outputLabels[NUM_BITS] = {2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
 
-	int count = 0;
-	bool update = true;
-	bool reset = false;
-	
 	CD4040() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+		numStages = NUM_BITS;
+		firstOutput = DIVIDE_OUTPUTS;
+		firstLight = DIVIDE_LIGHTS;
+		cascade.units = NUM_BITS;
 		
 		configInput(CLOCK_INPUT, "Clock");
 		configInput(RESET_INPUT, "Reset");
@@ -64,8 +67,7 @@ struct CD4040 : Module {
 		
 		setIOMode(VCVRACK_STANDARD);
 		count = 0;
-		update = true;
-		reset = false;
+		prevCount = -1;
 	}
 	
 	void onReset() override {
@@ -73,13 +75,15 @@ struct CD4040 : Module {
 		resetInput.reset();
 
 		count = 0;
-		update = true;
-		reset = true;
+		prevCount = -1;
 	}
 
 	void setIOMode (int mode) {
-		clockInput.setMode(mode);
-		resetInput.setMode(mode);
+		clockInput.setThresholds(&thresholds);
+		resetInput.setThresholds(&thresholds);
+		
+		// force the outputs to be rewritten at the new gate voltage
+		prevCount = -1;
 		
 		// set gate voltage
 		#include "../modes/setGateVoltage.hpp"
@@ -89,6 +93,7 @@ struct CD4040 : Module {
 		json_t *root = json_object();
 
 		json_object_set_new(root, "moduleVersion", json_integer(1));
+		json_object_set_new(root, "cascade", json_boolean(cascade.enabled));
 		
 		// add the I/O mode details
 		#include "../modes/dataToJson.hpp"
@@ -98,21 +103,28 @@ struct CD4040 : Module {
 	
 	void dataFromJson(json_t *root) override {
 
+		json_t *jsonCascade = json_object_get(root, "cascade");
+		cascade.enabled = jsonCascade ? json_boolean_value(jsonCascade) : false;
+		cascade.changed = true;
+
 		// grab the I/O mode details
 		#include "../modes/dataFromJson.hpp"
 	}	
 
 	void process(const ProcessArgs &args) override {
+		// when we're part of a cascade the counter at its head does all the work
+		if (isCascaded())
+			return;
+		
+		// run the logic at the selected rate and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
+
+	void processLogic(const ProcessArgs &args) {
 
 		// are we reset?
-		if (resetInput.process(inputs[RESET_INPUT].getVoltage())) {
+		if (resetInput.process(inputs[RESET_INPUT].getVoltage()))
 			count = 0;
-			
-			if (!reset)
-				update = true;
-				
-			reset = true;
-		}
 		else {
 			// process the clock
 			bool prevClock = clockInput.isHigh();
@@ -120,34 +132,17 @@ struct CD4040 : Module {
 			
 			// note - negative edge!
 			if (prevClock && !clock) {
-				if (++count >= MAX_COUNT)
-					count = 0;
-
-				update = true;
-				reset = false;
+				count = (count + 1) & stageMask(cascade.length);
 			}
 		}
 		
-		// decode the outputs
-		int g = 0;
-		for (int i = 1; i < NUM_BITS_PLUS_1; i++) {
-			bool q = (count & bitmap[i]) > 0;
-
-			if (q) {
-				outputs[DIVIDE_OUTPUTS + g].setVoltage(gateVoltage);
-				if (update)
-					lights[DIVIDE_LIGHTS + g].setBrightness(1.0f);
-			}
-			else {
-				outputs[DIVIDE_OUTPUTS + g].setVoltage(0.0f);
-				if (update)
-					lights[DIVIDE_LIGHTS + g].setBrightness(0.0f);
-			}
-
-			g++;
-		}
-		
-		update = false;
+		// update our own outputs and those of any counters to our right
+		setCount(count & stageMask(NUM_BITS), alwaysWriteOutputs());
+		driveCascade();
+	}
+	
+	float getGateVoltage() override {
+		return gateVoltage;
 	}
 };
 
@@ -180,7 +175,6 @@ struct CD4040Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4040 *module = dynamic_cast<CD4040*>(this->module);
 		assert(module);
@@ -188,10 +182,19 @@ struct CD4040Widget : ModuleWidget {
 		// blank separator
 		menu->addChild(new MenuSeparator());
 		
-		// add the I/O mode menu items
-		#include "../modes/modeMenus.hpp"
+		// add the cascade menu item
+		CascadeMenuItem *cascadeMenuItem = createMenuItem<CascadeMenuItem>("Cascade with left neighbour", CHECKMARK(module->cascade.enabled));
+		cascadeMenuItem->cascade = &module->cascade;
+		menu->addChild(cascadeMenuItem);
+		
+		// a cascaded counter is driven by the head of the cascade so its own settings don't apply
+		if (module->cascade.offset > 0)
+			menu->addChild(createMenuLabel("Driven by the head of the cascade"));
+		else {
+			// add the I/O mode menu items
+			#include "../modes/modeMenus.hpp"
+		}
 	}	
-#endif	
 };
 
 Model *modelCD4040 = createModel<CD4040, CD4040Widget>("CD4040");
@@ -9,6 +9,9 @@
 
 // used by mode management includes
 #define MODULE_NAME CD4041
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 #define NUM_GATES 4
 
@@ -60,7 +63,7 @@ struct CD4041 : Module {
 		
 		// set CMOS input properties
 		for (int g = 0; g < NUM_GATES; g++) {
-			aInputs[g].setMode(mode);
+			aInputs[g].setThresholds(&thresholds);
 		}
 		
 		// set gate voltage
@@ -85,6 +88,11 @@ struct CD4041 : Module {
 	}	
 
 	void process(const ProcessArgs &args) override {
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
+
+	void processLogic(const ProcessArgs &args) {
 		
 		int in = A_INPUTS;
 		int qOut = Q_OUTPUTS;
@@ -140,7 +148,6 @@ struct CD4041Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4041 *module = dynamic_cast<CD4041*>(this->module);
 		assert(module);
@@ -151,7 +158,6 @@ struct CD4041Widget : ModuleWidget {
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}
-#endif	
 };
 
 Model *modelCD4041 = createModel<CD4041, CD4041Widget>("CD4041");
@@ -6,9 +6,14 @@
 #include "../LunettaModula.hpp"
 #include "../inc/Utility.hpp"
 #include "../inc/CMOSInput.hpp"
+#include "../inc/LogicOversampler.hpp"
 
 // used by mode management includes
 #define MODULE_NAME CD4042
+#define LOGIC_OVERSAMPLING
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 #define NUM_GATES 4
 
@@ -36,11 +41,16 @@ struct CD4042 : Module {
 	// add the variables we'll use when managing modes
 	#include "../modes/modeVariables.hpp"
 	
-	bool qValues[NUM_GATES] = {};
+	CMOSPolyInput dataInputs[NUM_GATES];
+	CMOSPolyInput clockInput;
+	CMOSPolyInput polarityInput;
 	
-	CMOSInput aInputs[NUM_GATES];
-	CMOSInput clockInput;
-	CMOSInput polarityInput;
+	// latched value of each gate with one bit per channel
+	int qValues[NUM_GATES] = {};
+	int prevQValues[NUM_GATES] = {};
+	
+	// the number of channels last written, 0 forces them all to be rewritten
+	int prevChannels = 0;
 	
 	CD4042() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
@@ -60,23 +70,28 @@ struct CD4042 : Module {
 	
 	void onReset() override {
 		for (int g = 0; g < NUM_GATES; g++) {
-			aInputs[g].reset();
-			qValues[g] = false;
+			dataInputs[g].reset();
+			qValues[g] = 0;
 		}
 		
 		clockInput.reset();
 		polarityInput.reset();
+		
+		prevChannels = 0;
 	}
 
 	void setIOMode (int mode) {
 		
 		// set CMOS input properties
 		for (int g = 0; g < NUM_GATES; g++) {
-			aInputs[g].setMode(mode);
+			dataInputs[g].setThresholds(&thresholds);
 		}
 		
-		clockInput.setMode(mode);
-		polarityInput.setMode(mode);
+		clockInput.setThresholds(&thresholds);
+		polarityInput.setThresholds(&thresholds);
+		
+		// force the outputs to be rewritten at the new gate voltage
+		prevChannels = 0;
 		
 		// set gate voltage
 		#include "../modes/setGateVoltage.hpp"
@@ -100,35 +115,38 @@ struct CD4042 : Module {
 	}	
 
 	void process(const ProcessArgs &args) override {
+		// run the logic at the selected rate and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
+
+	void processLogic(const ProcessArgs &args) {
 
-		// process polarity function
-		bool clock = clockInput.process(inputs[CLOCK_INPUT].getVoltage());
-		bool polarity = polarityInput.process(inputs[POLARITY_INPUT].getVoltage());
+		int channels = 1;
+		for (int i = 0; i < NUM_INPUTS; i++)
+			channels = std::max(channels, inputs[i].getChannels());
 		
-		bool latch = (polarity != clock);
+		bool force = alwaysWriteOutputs() || channels != prevChannels;
+		prevChannels = channels;
 		
-		// process gates
-		int in = D_INPUTS;
-		int qOut = Q_OUTPUTS;
-		int nqOut = NQ_OUTPUTS;
-		int qLed = Q_LIGHTS;
-		int nqLed = NQ_LIGHTS;
+		// process polarity function - the channels where the clock differs from the polarity hold their data
+		int latch = clockInput.process(inputs[CLOCK_INPUT], channels) ^ polarityInput.process(inputs[POLARITY_INPUT], channels);
+		int mask = (1 << channels) - 1;
+		
+		// process gates, all channels at once
 		for (int g = 0; g < NUM_GATES; g++) {
-			bool q = qValues[g] = (latch ? qValues[g] : aInputs[g].process(inputs[in++].getVoltage()));
+			int d = dataInputs[g].process(inputs[D_INPUTS + g], channels);
+			qValues[g] = (qValues[g] & latch) | (d & ~latch & mask);
 			
-			if (q) {
-				outputs[qOut++].setVoltage(gateVoltage);
-				lights[qLed++].setBrightness(1.0f);
-
-				outputs[nqOut++].setVoltage(0.0f);
-				lights[nqLed++].setBrightness(0.0f);
-			}
-			else {
-				outputs[qOut++].setVoltage(0.0f);
-				lights[qLed++].setBrightness(0.0f);
-
-				outputs[nqOut++].setVoltage(gateVoltage);
-				lights[nqLed++].setBrightness(1.0f);
+			if (force || qValues[g] != prevQValues[g]) {
+				prevQValues[g] = qValues[g];
+				
+				setChannelGates(outputs[Q_OUTPUTS + g], qValues[g], channels, gateVoltage);
+				setChannelGates(outputs[NQ_OUTPUTS + g], ~qValues[g], channels, gateVoltage);
+				
+				// lights show the first channel
+				bool q = qValues[g] & 1;
+				lights[Q_LIGHTS + g].setBrightness(boolToLight(q));
+				lights[NQ_LIGHTS + g].setBrightness(boolToLightInverted(q));
 			}
 		}
 	}
@@ -165,7 +183,6 @@ struct CD4042Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4042 *module = dynamic_cast<CD4042*>(this->module);
 		assert(module);
@@ -176,7 +193,6 @@ struct CD4042Widget : ModuleWidget {
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}	
-#endif	
 };
 
 Model *modelCD4042 = createModel<CD4042, CD4042Widget>("CD4042");
@@ -9,9 +9,54 @@
 
 // used by mode management includes
 #define MODULE_NAME CD4048
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 #define NUM_GATES 4
 
+// the gate, expand and function inputs are all modelled together and packed into a single word with A-D
+// in bits 0-3, E-H in bits 4-7, EXP in bit 8 and KA/KB/KC in bits 9-11
+#define NUM_LOGIC_INPUTS 12
+#define NUM_TABLE_ENTRIES 4096
+
+// the function selected by KA/KB/KC, KA being the most significant bit
+constexpr int cd4048Function(int index) {
+	return (((index >> 9) & 1) << 2) | (((index >> 10) & 1) << 1) | ((index >> 11) & 1);
+}
+
+// primary logic - the AND based functions AND their inputs together, the OR based ones OR them
+constexpr bool cd4048Primary(int function, int inputs) {
+	return function >= 4 ? inputs == 0x0F : inputs != 0;
+}
+
+// secondary logic combining the two primary gates and the expand input
+constexpr bool cd4048Secondary(int function, bool abcd, bool efgh, bool exp) {
+	return (function == 1 || function == 7) ? (abcd || efgh || exp) :		// OR, AND-OR
+		(function == 0 || function == 6) ? !(abcd || efgh || exp) :		// NOR, AND-NOR
+		(function == 2 || function == 4) ? (abcd && efgh && !exp) :		// OR-AND, AND
+		!(abcd && efgh && !exp);										// OR-NAND, NAND
+}
+
+constexpr bool cd4048J(int index) {
+	return cd4048Secondary(cd4048Function(index), cd4048Primary(cd4048Function(index), index & 0x0F), 
+		cd4048Primary(cd4048Function(index), (index >> 4) & 0x0F), (index >> 8) & 1);
+}
+
+// 64 entries of the truth table packed into a word
+constexpr uint64_t cd4048Word(int word, int bit) {
+	return (cd4048J(word * 64 + bit) ? (uint64_t)1 << bit : 0) | (bit > 0 ? cd4048Word(word, bit - 1) : 0);
+}
+
+#define CD4048_WORDS(n) cd4048Word(n, 63), cd4048Word(n + 1, 63), cd4048Word(n + 2, 63), cd4048Word(n + 3, 63), \
+	cd4048Word(n + 4, 63), cd4048Word(n + 5, 63), cd4048Word(n + 6, 63), cd4048Word(n + 7, 63)
+
+// J output for every combination of inputs and functions, generated at compile time
+static constexpr uint64_t CD4048_TRUTH_TABLE[NUM_TABLE_ENTRIES / 64] = {
+	CD4048_WORDS(0), CD4048_WORDS(8), CD4048_WORDS(16), CD4048_WORDS(24),
+	CD4048_WORDS(32), CD4048_WORDS(40), CD4048_WORDS(48), CD4048_WORDS(56)
+};
+
 struct CD4048 : Module {
 	enum ParamIds {
 		NUM_PARAMS
@@ -50,14 +95,14 @@ struct CD4048 : Module {
 	// add the variables we'll use when managing modes
 	#include "../modes/modeVariables.hpp"
 	
-	CMOSInput abcdInputs[NUM_GATES];
-	CMOSInput efghInputs[NUM_GATES];
-	CMOSInput kaInput;
-	CMOSInput kbInput;
-	CMOSInput kcInput;
-	CMOSInput expInput;
+	CMOSInputBank logicInputs = CMOSInputBank(NUM_LOGIC_INPUTS);
+	
+	// input voltages in the order the bank expects them
+	float voltages[NUM_LOGIC_INPUTS] = {};
 	
-	int processCount = 8;
+	// output state and function as last written, -1 forces them to be rewritten
+	int prevJ = -1;
+	int prevFunction = -1;
 	
 	CD4048() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
@@ -77,34 +122,21 @@ struct CD4048 : Module {
 		configOutput(J_OUTPUT, "J");
 				
 		setIOMode(VCVRACK_STANDARD);
-		
-		processCount = 8;
 	}
 	
 	void onReset() override {
-		for (int g = 0; g < NUM_GATES; g++) {
-			abcdInputs[g].reset();
-			efghInputs[g].reset();
-		}
+		logicInputs.reset();
 		
-		kaInput.reset();
-		kbInput.reset();
-		kcInput.reset();
-		expInput.reset();
+		prevJ = -1;
 	}
 
 	void setIOMode (int mode) {
 		
 		// set CMOS input properties
-		for (int g = 0; g < NUM_GATES; g++) {
-			abcdInputs[g].setMode(mode);
-			efghInputs[g].setMode(mode);
-		}
+		logicInputs.setThresholds(&thresholds);
 		
-		kaInput.setMode(mode);
-		kbInput.setMode(mode);
-		kcInput.setMode(mode);
-		expInput.setMode(mode);
+		// force the output to be rewritten at the new gate voltage
+		prevJ = -1;
 		
 		// set gate voltage
 		#include "../modes/setGateVoltage.hpp"
@@ -128,80 +160,33 @@ struct CD4048 : Module {
 	}	
 
 	void process(const ProcessArgs &args) override {
-		
-		// process the function inputs
-		int function = (kaInput.process(inputs[KA_INPUT].getVoltage()) ? 0x04 : 0x00) +	
-						(kbInput.process(inputs[KB_INPUT].getVoltage()) ? 0x02: 0x00) +
-						(kcInput.process(inputs[KC_INPUT].getVoltage()) ? 0x01: 0x00);
-
-		// expansion input
-		bool exp = expInput.process(inputs[EXP_INPUT].getVoltage());
-
-		// process primary gate logic
-		bool abcd = false, efgh = false;
-		switch (function) {
-			case OR_FUNCTION:
-			case NOR_FUNCTION:
-			case OR_AND_FUNCTION:
-			case OR_NAND_FUNCTION:
-				// (A | B | C | D) / (E | F | G | H)
-				for (int g = 0; g < NUM_GATES; g++) {
-					abcd |= abcdInputs[g].process(inputs[ABCD_INPUTS + g].getVoltage());
-					efgh |= efghInputs[g].process(inputs[EFGH_INPUTS + g].getVoltage()); 
-				}
-				
-				break;
-				
-			case AND_FUNCTION:
-			case NAND_FUNCTION:
-			case AND_OR_FUNCTION:
-			case AND_NOR_FUNCTION:
-				// (A & B & C & D) / (E & F & G & H)
-				abcd = efgh = true;
-				for (int g = 0; g < NUM_GATES; g++) {
-					abcd &= abcdInputs[g].process(inputs[ABCD_INPUTS + g].getVoltage());
-					efgh &= efghInputs[g].process(inputs[EFGH_INPUTS + g].getVoltage()); 
-				}
-				break;
-		}
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
 
-		// now determine the secondary logic
-		bool j = false;
-		switch (function) {
-			case OR_FUNCTION:		// J = (A | B | C | D) | (E | F | G | H) | EXP)
-			case AND_OR_FUNCTION:	// J = (A & B & C & D) | (E & F & G & H) | EXP
-				j = abcd | efgh | exp;
-				break;
-			case NOR_FUNCTION:		// J = !((A | B | C | D) | (E | F | G | H) | EXP)
-			case AND_NOR_FUNCTION:	// J = !((A & B & C & D) | (E & F & G & H) | EXP)
-				j = !(abcd | efgh | exp);
-				break;
-			case AND_FUNCTION:		// J = (A & B & C & D) & (E & F & G & H) & !EXP)
-			case OR_AND_FUNCTION:	// J = (A | B | C | D) & (E | F | G | H) & !EXP
-				j = abcd & efgh & !exp;
-				break;
-			case NAND_FUNCTION:		// J = !((A & B & C & D) & (E & F & G & H) & !EXP)
-			case OR_NAND_FUNCTION:	// J = !((A | B | C | D) & (E | F | G | H) & !EXP)
-				j = !(abcd & efgh & !exp);
-				j = !(abcd & efgh & !exp);
-				break;
-		}
+	void processLogic(const ProcessArgs &args) {
 		
-		if (j) {
-			outputs[J_OUTPUT].setVoltage(gateVoltage);
-			lights[J_LIGHT].setBrightness(1.0f);
-		}
-		else {
-			outputs[J_OUTPUT].setVoltage(0.0f);
-			lights[J_LIGHT].setBrightness(0.0f);
+		// the input ids are already in the order of the bits in the table index
+		for (int i = 0; i < NUM_LOGIC_INPUTS; i++)
+			voltages[i] = inputs[i].getVoltage();
+		
+		int index = logicInputs.process(voltages);
+		int j = (CD4048_TRUTH_TABLE[index >> 6] >> (index & 63)) & 1;
+		
+		if (j != prevJ || alwaysWriteOutputs()) {
+			prevJ = j;
+			outputs[J_OUTPUT].setVoltage(boolToGate(j));
+			lights[J_LIGHT].setBrightness(boolToLight(j));
 		}
 		
 		// show status
-		if (++processCount > 8) {
-			processCount = 0;
+		int function = cd4048Function(index);
+		if (function != prevFunction) {
+			if (prevFunction >= 0)
+				lights[STATUS_LIGHTS + prevFunction].setBrightness(0.0f);
 			
-			for (int i = 0; i < NUM_FUNCTIONS; i++)
-				lights[STATUS_LIGHTS + i].setBrightness(boolToLight(i == function));
+			lights[STATUS_LIGHTS + function].setBrightness(1.0f);
+			prevFunction = function;
 		}
 	}
 };
@@ -245,7 +230,6 @@ struct CD4048Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4048 *module = dynamic_cast<CD4048*>(this->module);
 		assert(module);
@@ -256,7 +240,6 @@ struct CD4048Widget : ModuleWidget {
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}
-#endif	
 };
 
 Model *modelCD4048 = createModel<CD4048, CD4048Widget>("CD4048");
@@ -9,6 +9,9 @@
 
 // used by mode management includes
 #define MODULE_NAME CD4049
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 #define NUM_GATES 6
 
@@ -54,7 +57,7 @@ struct CD4049 : Module {
 		
 		// set CMOS input properties
 		for (int g = 0; g < NUM_GATES; g++) {
-			iInputs[g].setMode(mode);
+			iInputs[g].setThresholds(&thresholds);
 		}
 		
 		// set gate voltage
@@ -79,6 +82,11 @@ struct CD4049 : Module {
 	}	
 
 	void process(const ProcessArgs &args) override {
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
+
+	void processLogic(const ProcessArgs &args) {
 		
 		// process gates
 		for (int g = 0; g < NUM_GATES; g++) {
@@ -121,7 +129,6 @@ struct CD4049Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4049 *module = dynamic_cast<CD4049*>(this->module);
 		assert(module);
@@ -132,7 +139,6 @@ struct CD4049Widget : ModuleWidget {
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}
-#endif	
 };
 
 Model *modelCD4049 = createModel<CD4049, CD4049Widget>("CD4049");
@@ -6,12 +6,24 @@
 #include "../LunettaModula.hpp"
 #include "../inc/Utility.hpp"
 #include "../inc/CMOSInput.hpp"
+#include "../inc/ExpanderCascade.hpp"
 
 // used by mode management includes
 #define MODULE_NAME CD4063
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 #define NUM_GATES 4
 
+// adjacent comparators can be chained into a single comparator of up to 32 bits
+#define MAX_CASCADE 8
+
+// comparison results, in the same order as the outputs
+#define RESULT_LT 1
+#define RESULT_EQ 2
+#define RESULT_GT 4
+
 struct CD4063 : Module {
 	enum ParamIds {
 		NUM_PARAMS
@@ -32,7 +44,7 @@ struct CD4063 : Module {
 		NUM_OUTPUTS
 	};
 	enum LightIds {
-			LT_LIGHT,
+		LT_LIGHT,
 		EQ_LIGHT,
 		GT_LIGHT,
 		NUM_LIGHTS
@@ -41,11 +53,18 @@ struct CD4063 : Module {
 	// add the variables we'll use when managing modes
 	#include "../modes/modeVariables.hpp"
 	
-	CMOSInput aInputs[NUM_GATES];
-	CMOSInput bInputs[NUM_GATES];
-	CMOSInput ltInput;
-	CMOSInput eqInput;
-	CMOSInput gtInput;
+	CMOSInput aInputs[NUM_GATES][PORT_MAX_CHANNELS];
+	CMOSInput bInputs[NUM_GATES][PORT_MAX_CHANNELS];
+	CMOSInput ltInputs[PORT_MAX_CHANNELS];
+	CMOSInput eqInputs[PORT_MAX_CHANNELS];
+	CMOSInput gtInputs[PORT_MAX_CHANNELS];
+	
+	// the result as last written to the outputs for each channel, -1 forces them to be rewritten
+	int prevResults[PORT_MAX_CHANNELS];
+	int prevChannels = 0;
+	
+	// where we sit in the chain, worked out when a neighbour or the cascade option changes
+	CascadeState cascade;
 	
 	CD4063() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
@@ -68,32 +87,44 @@ struct CD4063 : Module {
 		configOutput(EQ_OUTPUT, "A equals B");
 		configOutput(GT_OUTPUT, "A greater than B");
 		
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++)
+			prevResults[c] = -1;
+		
 		setIOMode(VCVRACK_STANDARD);
 	}
 	
 	void onReset() override {
-		for (int g = 0; g < NUM_GATES; g++) {
-			aInputs[g].reset();
-			bInputs[g].reset();
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++) {
+			for (int g = 0; g < NUM_GATES; g++) {
+				aInputs[g][c].reset();
+				bInputs[g][c].reset();
+			}
+			
+			ltInputs[c].reset();
+			eqInputs[c].reset();
+			gtInputs[c].reset();
+			
+			prevResults[c] = -1;
 		}
-		
-		ltInput.reset();
-		eqInput.reset();
-		gtInput.reset();
 	}
 
 	void setIOMode (int mode) {
 		
 		// set CMOS input properties
-		for (int g = 0; g < NUM_GATES; g++) {
-			aInputs[g].setMode(mode);
-			bInputs[g].setMode(mode);
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++) {
+			for (int g = 0; g < NUM_GATES; g++) {
+				aInputs[g][c].setThresholds(&thresholds);
+				bInputs[g][c].setThresholds(&thresholds);
+			}
+			
+			ltInputs[c].setThresholds(&thresholds);
+			eqInputs[c].setThresholds(&thresholds);
+			gtInputs[c].setThresholds(&thresholds);
+			
+			// force the outputs to be rewritten at the new gate voltage
+			prevResults[c] = -1;
 		}
 		
-		ltInput.setMode(mode);
-		eqInput.setMode(mode);
-		gtInput.setMode(mode);
-		
 		// set gate voltage
 		#include "../modes/setGateVoltage.hpp"
 	}
@@ -102,6 +133,7 @@ struct CD4063 : Module {
 		json_t *root = json_object();
 
 		json_object_set_new(root, "moduleVersion", json_integer(1));
+		json_object_set_new(root, "cascade", json_boolean(cascade.enabled));
 		
 		// add the I/O mode details
 		#include "../modes/dataToJson.hpp"		
@@ -111,78 +143,113 @@ struct CD4063 : Module {
 	
 	void dataFromJson(json_t *root) override {
 
+		json_t *jsonCascade = json_object_get(root, "cascade");
+		cascade.enabled = jsonCascade ? json_boolean_value(jsonCascade) : false;
+		cascade.changed = true;
+
 		// grab the I/O mode details
 		#include "../modes/dataFromJson.hpp"
 	}	
 
+	static CascadeState *cascadeOf(Module *m) {
+		return (m && m->model == modelCD4063) ? &static_cast<CD4063*>(m)->cascade : NULL;
+	}
+	
+	void onExpanderChange(const ExpanderChangeEvent &e) override {
+		updateCascade(this, cascadeOf, MAX_CASCADE);
+	}
+
 	void process(const ProcessArgs &args) override {
+		if (cascade.changed)
+			updateCascade(this, cascadeOf, MAX_CASCADE);
 		
-		// process gates
-		int a = 0, b = 0, v = 1;
-		for (int g = 0; g < NUM_GATES; g++) {
-			
-			if (aInputs[g].process(inputs[A_INPUTS + g].getVoltage()))
-				a += v;
-
-			if (bInputs[g].process(inputs[B_INPUTS + g].getVoltage()))
-				b += v;
+		// when we're part of a chain the comparator at its head does all the work
+		if (cascade.offset > 0)
+			return;
+		
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
 
-			v *= 2;
+	void processLogic(const ProcessArgs &args) {
+		
+		// find the rest of the chain and the number of channels we need across all of it
+		CD4063 *chain[MAX_CASCADE];
+		int n = 0;
+		int channels = std::max(inputs[LT_INPUT].getChannels(), std::max(inputs[EQ_INPUT].getChannels(), inputs[GT_INPUT].getChannels()));
+		for (Module *m = this; cascadeOf(m) && cascadeOf(m)->offset == n; m = m->rightExpander.module) {
+			CD4063 *comparator = static_cast<CD4063*>(m);
+			for (int i = 0; i < NUM_GATES * 2; i++)
+				channels = std::max(channels, comparator->inputs[A_INPUTS + i].getChannels());
+				
+			chain[n++] = comparator;
 		}
-	
-		if (a == b) {
-			// input bits are equal, output the cascade iputs
-			bool ltIn = ltInput.process(inputs[LT_INPUT].getVoltage());
-			bool eqIn = gtInput.process(inputs[EQ_INPUT].getNormalVoltage(gateVoltage));
-			bool gtIn = gtInput.process(inputs[GT_INPUT].getVoltage());
-
-			if (ltIn) {
-				outputs[LT_OUTPUT].setVoltage(gateVoltage);
-				lights[LT_LIGHT].setBrightness(1.0f);
-			}
-			else {
-				outputs[LT_OUTPUT].setVoltage(0.0f);
-				lights[LT_LIGHT].setBrightness(0.0f);
+		
+		channels = std::max(channels, 1);
+		for (int i = 0; i < n; i++)
+			chain[i]->setChannels(channels);
+		
+		for (int c = 0; c < channels; c++) {
+			// pack the whole chain's A and B inputs into words, A1/B1 of this comparator being the least significant bits
+			uint64_t a = 0, b = 0;
+			for (int i = 0; i < n; i++) {
+				a |= (uint64_t)chain[i]->readWord(chain[i]->aInputs, A_INPUTS, c) << (i * NUM_GATES);
+				b |= (uint64_t)chain[i]->readWord(chain[i]->bInputs, B_INPUTS, c) << (i * NUM_GATES);
 			}
 			
-			if (eqIn) {
-				outputs[EQ_OUTPUT].setVoltage(gateVoltage);
-				lights[EQ_LIGHT].setBrightness(1.0f);
-			}
-			else {
-				outputs[EQ_OUTPUT].setVoltage(0.0f);
-				lights[EQ_LIGHT].setBrightness(0.0f);
-			}
+			// the cascade inputs decide the result when the words are equal, EQ being normalled high
+			int cascade = (ltInputs[c].process(inputs[LT_INPUT].getPolyVoltage(c)) ? RESULT_LT : 0) |
+				(eqInputs[c].process(inputs[EQ_INPUT].getNormalPolyVoltage(gateVoltage, c)) ? RESULT_EQ : 0) |
+				(gtInputs[c].process(inputs[GT_INPUT].getPolyVoltage(c)) ? RESULT_GT : 0);
 			
-			if (gtIn) {
-				outputs[GT_OUTPUT].setVoltage(gateVoltage);
-				lights[GT_LIGHT].setBrightness(1.0f);
-			}
-			else {
-				outputs[GT_OUTPUT].setVoltage(0.0f);
-				lights[GT_LIGHT].setBrightness(0.0f);
-			}
-		}
-		else {
-			// not equal, process lt/gt
-			bool lt = (a < b);
-			if (lt) {
-				outputs[LT_OUTPUT].setVoltage(gateVoltage);
-				lights[LT_LIGHT].setBrightness(1.0f);
+			// each comparator gives the result of its own bits and all of those below it
+			for (int i = 0; i < n; i++) {
+				uint64_t mask = ((uint64_t)1 << ((i + 1) * NUM_GATES)) - 1;
+				uint64_t ai = a & mask;
+				uint64_t bi = b & mask;
 				
-				outputs[GT_OUTPUT].setVoltage(0.0f);
-				lights[GT_LIGHT].setBrightness(0.0f);
+				int result = (ai == bi) ? cascade : (ai < bi ? RESULT_LT : RESULT_GT);
+				chain[i]->setResult(result, c, alwaysWriteOutputs());
 			}
-			else {
-				outputs[LT_OUTPUT].setVoltage(0.0f);
-				lights[LT_LIGHT].setBrightness(0.0f);
+		}
+	}
+	
+	int readWord(CMOSInput bank[][PORT_MAX_CHANNELS], int firstInput, int c) {
+		int word = 0;
+		for (int g = 0; g < NUM_GATES; g++)
+			word |= (bank[g][c].process(inputs[firstInput + g].getPolyVoltage(c)) ? 1 : 0) << g;
+			
+		return word;
+	}
+	
+	void setChannels(int channels) {
+		if (channels != prevChannels) {
+			prevChannels = channels;
+			
+			for (int r = 0; r < 3; r++)
+				outputs[LT_OUTPUT + r].setChannels(channels);
+			
+			for (int c = 0; c < channels; c++)
+				prevResults[c] = -1;
+		}
+	}
+	
+	// outputs are only written when the result changes, the lights show the first channel
+	void setResult(int result, int c, bool force) {
+		int changed = force ? 0x07 : result ^ prevResults[c];
+		if (changed == 0)
+			return;
+		
+		prevResults[c] = result;
+		
+		for (int r = 0; r < 3; r++) {
+			if ((changed >> r) & 1) {
+				bool q = (result >> r) & 1;
+				outputs[LT_OUTPUT + r].setVoltage(boolToGate(q), c);
 				
-				outputs[GT_OUTPUT].setVoltage(gateVoltage);
-				lights[GT_LIGHT].setBrightness(1.0f);
+				if (c == 0)
+					lights[LT_LIGHT + r].setBrightness(boolToLight(q));
 			}
-			
-			outputs[EQ_OUTPUT].setVoltage(0.0f);
-			lights[EQ_LIGHT].setBrightness(0.0f);
 		}
 	}
 };
@@ -221,7 +288,6 @@ struct CD4063Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4063 *module = dynamic_cast<CD4063*>(this->module);
 		assert(module);
@@ -229,10 +295,19 @@ struct CD4063Widget : ModuleWidget {
 		// blank separator
 		menu->addChild(new MenuSeparator());
 		
-		// add the I/O mode menu items
-		#include "../modes/modeMenus.hpp"
+		// add the cascade menu item
+		CascadeMenuItem *cascadeMenuItem = createMenuItem<CascadeMenuItem>("Cascade with left neighbour", CHECKMARK(module->cascade.enabled));
+		cascadeMenuItem->cascade = &module->cascade;
+		menu->addChild(cascadeMenuItem);
+		
+		// a chained comparator is driven by the head of the chain so its own settings don't apply
+		if (module->cascade.offset > 0)
+			menu->addChild(createMenuLabel("Driven by the head of the chain"));
+		else {
+			// add the I/O mode menu items
+			#include "../modes/modeMenus.hpp"
+		}
 	}
-#endif	
 };
 
 Model *modelCD4063 = createModel<CD4063, CD4063Widget>("CD4063");
@@ -9,6 +9,9 @@
 
 // used by mode management includes
 #define MODULE_NAME CD4068
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 struct CD4068 : Module {
 	enum ParamIds {
@@ -60,7 +63,7 @@ struct CD4068 : Module {
 		
 		// set CMOS input properties
 		for (int g = 0; g < 8; g++) {
-			aInputs[g].setMode(mode);
+			aInputs[g].setThresholds(&thresholds);
 		}
 		
 		// set gate voltage
@@ -85,6 +88,11 @@ struct CD4068 : Module {
 	}	
 
 	void process(const ProcessArgs &args) override {
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
+
+	void processLogic(const ProcessArgs &args) {
 		
 		// process gates
 		bool q = true;
@@ -135,7 +143,6 @@ struct CD4068Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4068 *module = dynamic_cast<CD4068*>(this->module);
 		assert(module);
@@ -146,7 +153,6 @@ struct CD4068Widget : ModuleWidget {
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}
-#endif	
 };
 
 Model *modelCD4068 = createModel<CD4068, CD4068Widget>("CD4068");
@@ -9,6 +9,9 @@
 
 // used by mode management includes
 #define MODULE_NAME CD4078
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 struct CD4078 : Module {
 	enum ParamIds {
@@ -60,7 +63,7 @@ struct CD4078 : Module {
 		
 		// set CMOS input properties
 		for (int g = 0; g < 8; g++) {
-			aInputs[g].setMode(mode);
+			aInputs[g].setThresholds(&thresholds);
 		}
 		
 		// set gate voltage
@@ -85,6 +88,11 @@ struct CD4078 : Module {
 	}	
 
 	void process(const ProcessArgs &args) override {
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
+
+	void processLogic(const ProcessArgs &args) {
 		
 		// process gates
 		bool q = false;
@@ -134,7 +142,6 @@ struct CD4078Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4078 *module = dynamic_cast<CD4078*>(this->module);
 		assert(module);
@@ -145,7 +152,6 @@ struct CD4078Widget : ModuleWidget {
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}
-#endif	
 };
 
 Model *modelCD4078 = createModel<CD4078, CD4078Widget>("CD4078");
@@ -9,6 +9,9 @@
 
 // used by mode management includes
 #define MODULE_NAME CD4086
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 #define NUM_GATES 4
 
@@ -37,10 +40,15 @@ struct CD4086 : Module {
 	// add the variables we'll use when managing modes
 	#include "../modes/modeVariables.hpp"
 	
-	CMOSInput aInputs[NUM_GATES];
-	CMOSInput bInputs[NUM_GATES];
-	CMOSInput inhInput;
-	CMOSInput enInput;
+	// the A, B, inhibit and enable inputs of each channel
+	CMOSInputBank channelInputs[PORT_MAX_CHANNELS];
+	float voltages[CMOS_INPUT_BANK_MAX] = {};
+	
+	// the J output of each channel as last written
+	int prevJ[PORT_MAX_CHANNELS] = {};
+	
+	// the number of channels last written, 0 forces them all to be rewritten
+	int prevChannels = 0;
 	
 	int processCount = 8;
 	
@@ -58,34 +66,30 @@ struct CD4086 : Module {
 		
 		configOutput(J_OUTPUT, "J");
 		
+		for (int ch = 0; ch < PORT_MAX_CHANNELS; ch++)
+			channelInputs[ch] = CMOSInputBank(NUM_INPUTS);
+		
 		setIOMode(VCVRACK_STANDARD);
 		
 		processCount = 8;
 	}
 	
 	void onReset() override {
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++)
+			channelInputs[c].reset();
 		
-		// gate inputs
-		for (int g = 0; g < NUM_GATES; g++) {
-			aInputs[g].reset();
-			bInputs[g].reset();
-		}
-		
-		// control inputs
-		inhInput.reset();
-		enInput.reset();
+		prevChannels = 0;
+		processCount = 8;
 	}
 	
 	void setIOMode (int mode) {
 		
 		// set CMOS input properties
-		for (int g = 0; g < NUM_GATES; g++) {
-			aInputs[g].setMode(mode);
-			bInputs[g].setMode(mode);
-		}
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++)
+			channelInputs[c].setThresholds(&thresholds);
 		
-		inhInput.setMode(mode);
-		enInput.setMode(mode);
+		// force the outputs to be rewritten at the new gate voltage
+		prevChannels = 0;
 		
 		// set gate voltage
 		#include "../modes/setGateVoltage.hpp"
@@ -109,33 +113,54 @@ struct CD4086 : Module {
 	}	
 
 	void process(const ProcessArgs &args) override {
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
+
+	void processLogic(const ProcessArgs &args) {
 		
-		// process gates
-		bool q = false;
-		for (int g = 0; g < NUM_GATES; g++) {
-			bool a = aInputs[g].process(inputs[A_INPUTS + g].getVoltage());
-			bool b = bInputs[g].process(inputs[B_INPUTS + g].getVoltage());
-			q |= (a && b);
-		}		
-
-		bool inhibit = inhInput.process(inputs[INH_INPUT].getVoltage());
-		bool enable = enInput.process(inputs[EN_INPUT].getNormalVoltage(gateVoltage));
-		
-		if (++processCount > 8) {
-			processCount++;
-			lights[INH_LIGHT].setBrightness(boolToLight(inhibit));
-			lights[EN_LIGHT].setBrightness(boolToLight(enable));
-		}
-		
-		bool j = (inhibit || !enable || q);
+		int channels = 1;
+		for (int i = 0; i < NUM_INPUTS; i++)
+			channels = std::max(channels, inputs[i].getChannels());
 		
-		if(!j) {
-			outputs[J_OUTPUT].setVoltage(gateVoltage);
-			lights[J_LIGHT].setBrightness(1.0f);
+		bool force = alwaysWriteOutputs();
+		if (channels != prevChannels) {
+			outputs[J_OUTPUT].setChannels(channels);
+			prevChannels = channels;
+			force = true;
 		}
-		else {
-			outputs[J_OUTPUT].setVoltage(0.0f);
-			lights[J_LIGHT].setBrightness(0.0f);
+		
+		bool lightsDue = (++processCount >= 8);
+		if (lightsDue)
+			processCount = 0;
+		
+		for (int c = 0; c < channels; c++) {
+			// the input ids are already in the order of the bits in the word, enable being normally high
+			for (int i = 0; i < EN_INPUT; i++)
+				voltages[i] = inputs[i].getPolyVoltage(c);
+			
+			voltages[EN_INPUT] = inputs[EN_INPUT].getNormalPolyVoltage(gateVoltage, c);
+			
+			int word = channelInputs[c].process(voltages);
+			
+			// AND each A with its B, OR the lot along with inhibit and not enable, then invert
+			int q = word & (word >> B_INPUTS) & 0x0F;
+			int j = (q || ((word >> INH_INPUT) & 1) || !((word >> EN_INPUT) & 1)) ? 0 : 1;
+			
+			if (force || j != prevJ[c]) {
+				prevJ[c] = j;
+				outputs[J_OUTPUT].setVoltage(boolToGate(j), c);
+				
+				// lights show the first channel
+				if (c == 0)
+					lights[J_LIGHT].setBrightness(boolToLight(j));
+			}
+			
+			// no need to update the status lights at audio rates
+			if (c == 0 && lightsDue) {
+				lights[INH_LIGHT].setBrightness(boolToLight((word >> INH_INPUT) & 1));
+				lights[EN_LIGHT].setBrightness(boolToLight((word >> EN_INPUT) & 1));
+			}
 		}
 	}
 };
@@ -169,7 +194,6 @@ struct CD4086Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4086 *module = dynamic_cast<CD4086*>(this->module);
 		assert(module);
@@ -180,7 +204,6 @@ struct CD4086Widget : ModuleWidget {
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}
-#endif	
 };
 
 Model *modelCD4086 = createModel<CD4086, CD4086Widget>("CD4086");
@@ -9,6 +9,9 @@
 
 // used by mode management includes
 #define MODULE_NAME CD4514
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 struct CD4514 : Module {
 	enum ParamIds {
@@ -25,6 +28,7 @@ struct CD4514 : Module {
 	};
 	enum OutputIds {
 		ENUMS(S_OUTPUTS, 16),
+		BUS_OUTPUT,
 		NUM_OUTPUTS
 	};
 	enum LightIds {
@@ -35,19 +39,20 @@ struct CD4514 : Module {
 	// add the variables we'll use when managing modes
 	#include "../modes/modeVariables.hpp"
 	
-	CMOSInput aInput;
-	CMOSInput bInput;
-	CMOSInput cInput;
-	CMOSInput dInput;
-	CMOSInput strobeInput;
-	CMOSInput inhibitInput;
+	// the data, strobe and inhibit inputs of each channel
+	CMOSInputBank channelInputs[PORT_MAX_CHANNELS];
+	float voltages[CMOS_INPUT_BANK_MAX] = {};
 	
-	bool prevClock = false;
-	int count = 0;
-	int prevCount = -2;
+	bool prevStrobe[PORT_MAX_CHANNELS] = {};
 	
-	bool inh = false;
-	bool prevInh =false;
+	// the value latched by each channel
+	int count[PORT_MAX_CHANNELS] = {};
+	
+	// the output set high on each channel as last written, -1 when inhibited
+	int prevActive[PORT_MAX_CHANNELS] = {};
+	
+	// the number of channels last written, 0 forces them all to be rewritten
+	int prevChannels = 0;
 	
 	CD4514() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
@@ -55,12 +60,12 @@ struct CD4514 : Module {
 		configInput(A_INPUT, "A");
 		configInput(B_INPUT, "B");
 		configInput(C_INPUT, "C");
-		configInput(D_INPUT, "B");
+		configInput(D_INPUT, "D");
 		configInput(STROBE_INPUT, "Strobe");
 		configInput(INHIBIT_INPUT, "Inhibit");
 
 		inputInfos[A_INPUT]->description = "Least significant bit";
-		inputInfos[B_INPUT]->description = "Most significant bit";
+		inputInfos[D_INPUT]->description = "Most significant bit";
 		inputInfos[STROBE_INPUT]->description = "Loads the decoder with the logic values present at the A-D inputs and sets the appropriate output high";
 		inputInfos[INHIBIT_INPUT]->description = "Forces all outputs low";
 
@@ -69,41 +74,33 @@ struct CD4514 : Module {
 			outputInfos[S_OUTPUTS + b]->description = "Active high (low when inhibited)";
 		}
 		
+		configOutput(BUS_OUTPUT, "Bus");
+		outputInfos[BUS_OUTPUT]->description = "S0 to S15 of the first channel on channels 1 to 16";
+		
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++)
+			channelInputs[c] = CMOSInputBank(NUM_INPUTS);
+		
 		setIOMode(VCVRACK_STANDARD);
-			
-		count = 1;
-		prevCount = 0;
-		prevInh = false;
 	}
 	
 	void onReset() override {
-	
-		aInput.reset();
-		bInput.reset();
-		cInput.reset();
-		dInput.reset();
-		strobeInput.reset();
-		inhibitInput.reset();
-		
-		for(int i = 0; i < 16; i++) {
-			outputs[S_OUTPUTS + i].setVoltage(0.0f);
-			lights[S_LIGHTS + i].setBrightness(0.0f);
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++) {
+			channelInputs[c].reset();
+			prevStrobe[c] = false;
+			count[c] = 0;
 		}
 		
-		count = 0;
-		prevCount = 0;
-		prevInh = false;
+		prevChannels = 0;
 	}
 	
 	void setIOMode (int mode) {
 		// set CMOS input properties
-		aInput.setMode(mode);
-		bInput.setMode(mode);
-		cInput.setMode(mode);
-		dInput.setMode(mode);
-		strobeInput.setMode(mode);
-		inhibitInput.setMode(mode);
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++)
+			channelInputs[c].setThresholds(&thresholds);
 
+		// force the outputs to be rewritten at the new gate voltage
+		prevChannels = 0;
+		
 		// set gate voltage
 		#include "../modes/setGateVoltage.hpp"
 	}	
@@ -128,52 +125,74 @@ struct CD4514 : Module {
 	}	
 
 	void process(const ProcessArgs &args) override {
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
 
-		// are we inhibited?
-		inh = inhibitInput.process(inputs[INHIBIT_INPUT].getVoltage());
+	void processLogic(const ProcessArgs &args) {
 
-		// process the strobe
-		bool clock = strobeInput.process(inputs[STROBE_INPUT].getVoltage());
+		int channels = 1;
+		for (int i = 0; i < NUM_INPUTS; i++)
+			channels = std::max(channels, inputs[i].getChannels());
 		
-		if (clock && !prevClock) {
-
-			// decode the data inputs
-			count = 0;
-			if (aInput.process(inputs[A_INPUT].getVoltage()))
-				count++;
-				
-			if (bInput.process(inputs[B_INPUT].getVoltage()))
-				count += 2;
-				
-			if (cInput.process(inputs[C_INPUT].getVoltage()))
-				count += 4;
-				
-			if (dInput.process(inputs[D_INPUT].getVoltage()))
-				count += 8;
+		bool force = alwaysWriteOutputs();
+		if (channels != prevChannels) {
+			for (int i = 0; i < 16; i++)
+				outputs[S_OUTPUTS + i].setChannels(channels);
+			
+			prevChannels = channels;
+			force = true;
 		}
-
-		int countToUse = inh ? 0 : count;
 		
-		// data outputs
-		if (prevCount != countToUse || prevInh != inh) {
-			if (inh) {
-				outputs[S_OUTPUTS + countToUse].setVoltage(0.0f);
-				lights[S_LIGHTS + countToUse].setBrightness(0.0f);
-			}
-			else {
-				outputs[S_OUTPUTS + countToUse].setVoltage(gateVoltage);
-				lights[S_LIGHTS + countToUse].setBrightness(1.0f);
-			}
-
-			if (prevCount >=0) {
-				outputs[S_OUTPUTS + prevCount].setVoltage(0.0f);
-				lights[S_LIGHTS + prevCount].setBrightness(0.0f);
+		for (int c = 0; c < channels; c++) {
+			// the input ids are already in the order of the bits in the word
+			for (int i = 0; i < NUM_INPUTS; i++)
+				voltages[i] = inputs[i].getPolyVoltage(c);
+			
+			int word = channelInputs[c].process(voltages);
+			
+			// latch the data inputs on the strobe
+			bool strobe = (word >> STROBE_INPUT) & 1;
+			if (strobe && !prevStrobe[c])
+				count[c] = word & 0x0F;
+			
+			prevStrobe[c] = strobe;
+			
+			// are we inhibited?
+			int active = ((word >> INHIBIT_INPUT) & 1) ? -1 : count[c];
+			
+			if (force || active != prevActive[c])
+				setActive(c, active, force);
+		}
+	}
+	
+	// move the high output of the given channel, only the outputs that change are written unless forced
+	void setActive(int c, int active, bool force) {
+		if (force) {
+			for (int i = 0; i < 16; i++)
+				outputs[S_OUTPUTS + i].setVoltage(0.0f, c);
+		}
+		else if (prevActive[c] >= 0)
+			outputs[S_OUTPUTS + prevActive[c]].setVoltage(0.0f, c);
+		
+		if (active >= 0)
+			outputs[S_OUTPUTS + active].setVoltage(gateVoltage, c);
+		
+		// lights and bus show the first channel
+		if (c == 0) {
+			for (int i = 0; i < 16; i++)
+				lights[S_LIGHTS + i].setBrightness(boolToLight(i == active));
+			
+			simd::float_4 line = simd::float_4(0.0f, 1.0f, 2.0f, 3.0f);
+			for (int i = 0; i < 16; i += 4) {
+				outputs[BUS_OUTPUT].setVoltageSimd(simd::ifelse(line == (float)active, simd::float_4(gateVoltage), simd::float_4::zero()), i);
+				line += 4.0f;
 			}
-			prevCount = countToUse;
+			
+			outputs[BUS_OUTPUT].setChannels(16);
 		}
-
-		prevInh = inh;
-		prevClock = clock;
+		
+		prevActive[c] = active;
 	}
 };
 
@@ -193,6 +212,9 @@ struct CD4514Widget : ModuleWidget {
 		addInput(createInputCentered<LunettaModulaLogicInputJack>(Vec(STD_COLUMN_POSITIONS[STD_COL1], STD_HALF_ROWS8(STD_ROW6)), module, CD4514::STROBE_INPUT));
 		addInput(createInputCentered<LunettaModulaLogicInputJack>(Vec(STD_COLUMN_POSITIONS[STD_COL1], STD_HALF_ROWS8(STD_ROW7)), module, CD4514::INHIBIT_INPUT));
 
+		// bus output
+		addOutput(createOutputCentered<LunettaModulaLogicOutputJack>(Vec(STD_COLUMN_POSITIONS[STD_COL1], STD_HALF_ROWS8(STD_ROW5)), module, CD4514::BUS_OUTPUT));
+
 		// decoded outputs
 		int outputId = CD4514::S_OUTPUTS;
 		int lightId = CD4514::S_LIGHTS;
@@ -209,7 +231,6 @@ struct CD4514Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4514 *module = dynamic_cast<CD4514*>(this->module);
 		assert(module);
@@ -220,7 +241,6 @@ struct CD4514Widget : ModuleWidget {
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}	
-#endif	
 };
 
 Model *modelCD4514 = createModel<CD4514, CD4514Widget>("CD4514");
@@ -6,14 +6,18 @@
 #include "../LunettaModula.hpp"
 #include "../inc/Utility.hpp"
 #include "../inc/CMOSInput.hpp"
+#include "../inc/LogicOversampler.hpp"
 
 // used by mode management includes
 #define MODULE_NAME CD4516
+#define LOGIC_OVERSAMPLING
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 #define MAX_COUNT 16
 #define MAX_COUNT_MINUS_1 15
 #define NUM_BITS 4
-#define NUM_BITS_PLUS_1 5
 
 struct CD4516 : Module {
 	enum ParamIds {
@@ -26,6 +30,7 @@ struct CD4516 : Module {
 		ENUMS(P_INPUTS, NUM_BITS),
 		PRESET_ENABLE_INPUT,
 		CARRY_INPUT,
+		PRESET_BUS_INPUT,
 		NUM_INPUTS
 	};
 	enum OutputIds {
@@ -44,73 +49,77 @@ struct CD4516 : Module {
 	// add the variables we'll use when managing modes
 	#include "../modes/modeVariables.hpp"
 	
-	CMOSInput clockInput;
-	CMOSInput resetInput;
-	CMOSInput updDownInput;
-	CMOSInput carryInput;
-	CMOSInput presetEnableInput;
-	CMOSInput presetInputs[NUM_BITS];
+	// the clock, reset, direction, preset, preset enable and carry inputs of each channel
+	CMOSInputBank channelInputs[PORT_MAX_CHANNELS];
+	float voltages[CMOS_INPUT_BANK_MAX] = {};
 	
-	const int bitmap[NUM_BITS_PLUS_1] = { 0, 1, 2, 4, 8};
-	const int outputLabels[NUM_BITS] = {2, 4, 8, 16 };
-
-	int count = 0;
-	bool update = true;
-	bool reset = false;
-	bool countUp = false;
+	// channels 1 to 4 of the preset bus
+	CMOSInputBank presetBusInput = CMOSInputBank(NUM_BITS);
+	
+	int counts[PORT_MAX_CHANNELS] = {};
+	bool prevClocks[PORT_MAX_CHANNELS] = {};
+	bool prevCarries[PORT_MAX_CHANNELS] = {};
+	
+	// the count and carry of each channel as last written to the outputs
+	int prevOutputs[PORT_MAX_CHANNELS] = {};
+	
+	// the number of channels last written, 0 forces them all to be rewritten
+	int prevChannels = 0;
+	
+	// direction of the first channel as shown on the lights, -1 forces them to be updated
+	int prevCountUp = -1;
 
 	CD4516() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
-		setIOMode(VCVRACK_STANDARD);
 		
 		configInput(CLOCK_INPUT, "Clock");
 		configInput(RESET_INPUT, "Reset");
 		configInput(PRESET_ENABLE_INPUT, "Preset enable");
 		configInput(CARRY_INPUT, "Carry");
 		configInput(countUp_INPUT, "Up/Down");
+		configInput(PRESET_BUS_INPUT, "Preset bus");
 		
 		inputInfos[CLOCK_INPUT]->description = "Negative edge triggered";
 		inputInfos[RESET_INPUT]->description = "Resets count to 0, holds all outputs low when high";
+		inputInfos[PRESET_BUS_INPUT]->description = "P1 to P4 on channels 1 to 4, replaces the P inputs when connected";
 		
 		for (int b = 0; b < NUM_BITS; b++) {
 			configOutput(Q_OUTPUTS + b, rack::string::f("Q%d", b + 1));
-			//outputInfos[Q_OUTPUTS + b]->description = rack::string::f("Divide by %d", outputLabels[b]);
 			configInput(P_INPUTS + b, rack::string::f("P%d", b + 1));
 		}
 
 		configOutput(CARRY_OUTPUT, "Carry");
 
-		count = 0;
-		update = true;
-		reset = false;
-		countUp = false;
+		// the preset bus isn't part of the per channel inputs
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++)
+			channelInputs[c] = CMOSInputBank(PRESET_BUS_INPUT);
+		
+		onReset();
+		
+		setIOMode(VCVRACK_STANDARD);
 	}
 	
 	void onReset() override {
-		clockInput.reset();
-		resetInput.reset();
-		updDownInput.reset();
-		presetEnableInput.reset();
-
-		for (int b = 0; b < NUM_BITS; b++) {
-			presetInputs[b].reset();
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++) {
+			channelInputs[c].reset();
+			counts[c] = 0;
+			prevClocks[c] = false;
+			prevCarries[c] = false;
 		}
 		
-		count = 0;
-		update = true;
-		reset = true;
-		countUp = false;
+		presetBusInput.reset();
+		prevChannels = 0;
+		prevCountUp = -1;
 	}
 
 	void setIOMode (int mode) {
-		clockInput.setMode(mode);
-		resetInput.setMode(mode);
-		updDownInput.setMode(mode);
-		presetEnableInput.setMode(mode);
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++)
+			channelInputs[c].setThresholds(&thresholds);
 		
-		for (int b = 0; b < NUM_BITS; b++) {
-			presetInputs[b].setMode(mode);
-		}
+		presetBusInput.setThresholds(&thresholds);
+
+		// force the outputs to be rewritten at the new gate voltage
+		prevChannels = 0;
 
 		// set gate voltage
 		#include "../modes/setGateVoltage.hpp"
@@ -134,119 +143,101 @@ struct CD4516 : Module {
 	}	
 
 	void process(const ProcessArgs &args) override {
+		// run the logic at the selected rate and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
 
-		bool prevcountUp = updDownInput.isHigh();
-		countUp = updDownInput.process(inputs[countUp_INPUT].getVoltage());
-		
-		if (prevcountUp != countUp) {
-			update = true;
-		}
-		
-		// are we reset?
-		if (resetInput.process(inputs[RESET_INPUT].getVoltage())) {
-			count = 0;
+	void processLogic(const ProcessArgs &args) {
 
-			if (!reset)
-				update = true;
-				
-			reset = true;
-		}
-		else {
+		int channels = 1;
+		for (int i = 0; i < PRESET_BUS_INPUT; i++)
+			channels = std::max(channels, inputs[i].getChannels());
+
+		bool force = alwaysWriteOutputs();
+		if (channels != prevChannels) {
+			for (int i = 0; i < NUM_BITS; i++)
+				outputs[Q_OUTPUTS + i].setChannels(channels);
 			
-			// process the carry input
-			bool prevCarryIn = carryInput.isHigh();
-			bool carryIn = carryInput.process(inputs[CARRY_INPUT].getVoltage());
-			if (prevCarryIn != carryIn)
-				update = true;
+			outputs[CARRY_OUTPUT].setChannels(channels);
 			
-			// process the clock inputs - low carry in halts the clock.
-			bool prevClock = clockInput.isHigh();
-			bool clock = clockInput.process(carryIn ? 0.0f : inputs[CLOCK_INPUT].getVoltage());
-
-			// need to be sure we don't double trigger on the rising clock when transitioning from carry state in the same cycle
-			if (!prevClock && prevCarryIn && !carryIn)
-				clock = false;
-
-			// are we presetting?
-			if (presetEnableInput.process(inputs[PRESET_ENABLE_INPUT].getVoltage())) {
-				int c = 0;
-				for (int p = 0, b = 1; p < NUM_BITS; p++, b++) {
-					float v = inputs[P_INPUTS + p].getVoltage();
-
-					if (presetInputs[p].process(v)) {
-						c += bitmap[b];
-					}
-				}
-
-				if (c != count) {
-					count = c;
-					update = true;
-				}
-			}
-			else {
-				// process the clock edge if required
-				if (!prevClock && clock) {
-					
-					if (countUp) {
-						if (++count > MAX_COUNT_MINUS_1)
-							count = 0;
-					}
-					else {
-						if (--count < 0)
-							count = MAX_COUNT_MINUS_1;
-					}
+			prevChannels = channels;
+			force = true;
+		}
 
-					update = true;
-					reset = false;
-				}
-			}
+		// the preset bus is shared by all channels
+		int busPreset = -1;
+		if (inputs[PRESET_BUS_INPUT].isConnected()) {
+			for (int b = 0; b < NUM_BITS; b++)
+				voltages[b] = inputs[PRESET_BUS_INPUT].getVoltage(b);
+			
+			busPreset = presetBusInput.process(voltages);
 		}
 		
-		// decode the outputs
-		int g = 0;
-		for (int i = 1; i < NUM_BITS_PLUS_1; i++) {
-			bool q = (count & bitmap[i]) > 0;
-
-			if (q) {
-				outputs[Q_OUTPUTS + g].setVoltage(gateVoltage);
-				if (update)
-					lights[Q_LIGHTS + g].setBrightness(1.0f);
-			}
+		for (int c = 0; c < channels; c++) {
+			// the input ids are already in the order of the bits in the word
+			for (int i = 0; i < PRESET_BUS_INPUT; i++)
+				voltages[i] = inputs[i].getPolyVoltage(c);
+			
+			int word = channelInputs[c].process(voltages);
+			bool countUp = (word >> countUp_INPUT) & 1;
+			int count = counts[c];
+			
+			// are we reset?
+			if ((word >> RESET_INPUT) & 1)
+				count = 0;
 			else {
-				outputs[Q_OUTPUTS + g].setVoltage(0.0f);
-				if (update)
-					lights[Q_LIGHTS + g].setBrightness(0.0f);
+				// process the carry input - low carry in halts the clock
+				bool carryIn = (word >> CARRY_INPUT) & 1;
+				bool clock = ((word >> CLOCK_INPUT) & 1) && !carryIn;
+				
+				// need to be sure we don't double trigger on the rising clock when transitioning from carry state in the same cycle
+				bool edge = clock && !prevClocks[c] && !(prevCarries[c] && !carryIn);
+				
+				prevClocks[c] = clock;
+				prevCarries[c] = carryIn;
+				
+				// are we presetting? the preset is taken as a whole word from the bus or the P inputs
+				if ((word >> PRESET_ENABLE_INPUT) & 1)
+					count = busPreset >= 0 ? busPreset : (word >> P_INPUTS) & 0x0F;
+				else if (edge)
+					count = (count + (countUp ? 1 : MAX_COUNT_MINUS_1)) & MAX_COUNT_MINUS_1;
+			}
+			
+			counts[c] = count;
+			
+			// set carry output - watch out, it's active low.
+			int carry = (count != (countUp ? MAX_COUNT_MINUS_1 : 0)) ? 1 : 0;
+			
+			setOutputs(c, count | (carry << NUM_BITS), force);
+			
+			// set direction leds
+			if (c == 0 && (int)countUp != prevCountUp) {
+				prevCountUp = countUp;
+				lights[UP_LIGHT].setBrightness(boolToLight(countUp));
+				lights[DOWN_LIGHT].setBrightness(boolToLight(!countUp));
 			}
-
-			g++;
 		}
+	}
+	
+	// count bits followed by the carry, only written when they change. The carry output and light follow
+	// straight on from the Q outputs and lights.
+	void setOutputs(int c, int bits, bool force) {
+		int changed = force ? 0x1F : bits ^ prevOutputs[c];
+		if (changed == 0)
+			return;
 		
-		// set carry output - watch out, it's active low.
-		bool carry = (count != (countUp ? MAX_COUNT_MINUS_1 : 0));
-		if (carry) {
-			outputs[CARRY_OUTPUT].setVoltage(gateVoltage);
-			if (update)
-				lights[CARRY_LIGHT].setBrightness(1.0f);
-		}
-		else {
-			outputs[CARRY_OUTPUT].setVoltage(0.0f);
-			if (update)
-				lights[CARRY_LIGHT].setBrightness(0.0f);
-		}
+		prevOutputs[c] = bits;
 		
-		// set direction leds
-		if (update) {
-			if (countUp) {
-				lights[UP_LIGHT].setBrightness(1.0f);
-				lights[DOWN_LIGHT].setBrightness(0.0f);
-			}
-			else {
-				lights[UP_LIGHT].setBrightness(0.0f);
-				lights[DOWN_LIGHT].setBrightness(1.0f);
+		for (int i = 0; i <= NUM_BITS; i++) {
+			if ((changed >> i) & 1) {
+				bool q = (bits >> i) & 1;
+				outputs[Q_OUTPUTS + i].setVoltage(boolToGate(q), c);
+				
+				// lights show the first channel
+				if (c == 0)
+					lights[Q_LIGHTS + i].setBrightness(boolToLight(q));
 			}
 		}
-		
-		update = false;
 	}
 };
 
@@ -264,6 +255,7 @@ struct CD4516Widget : ModuleWidget {
 		addInput(createInputCentered<LunettaModulaLogicInputJack>(Vec(STD_COLUMN_POSITIONS[STD_COL1], STD_ROWS6[STD_ROW6]), module, CD4516::countUp_INPUT));
 		addInput(createInputCentered<LunettaModulaLogicInputJack>(Vec(STD_COLUMN_POSITIONS[STD_COL5], STD_ROWS6[STD_ROW1]), module, CD4516::CARRY_INPUT));
 		addInput(createInputCentered<LunettaModulaLogicInputJack>(Vec(STD_COLUMN_POSITIONS[STD_COL3], STD_ROWS6[STD_ROW1]), module, CD4516::PRESET_ENABLE_INPUT));
+		addInput(createInputCentered<LunettaModulaLogicInputJack>(Vec(STD_COLUMN_POSITIONS[STD_COL1], STD_ROWS6[STD_ROW1]), module, CD4516::PRESET_BUS_INPUT));
 
 		// bit inputs/outputs/lights
 		int i = 0;
@@ -292,7 +284,6 @@ struct CD4516Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4516 *module = dynamic_cast<CD4516*>(this->module);
 		assert(module);
@@ -303,7 +294,6 @@ struct CD4516Widget : ModuleWidget {
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}	
-#endif	
 };
 
 Model *modelCD4516 = createModel<CD4516, CD4516Widget>("CD4516");
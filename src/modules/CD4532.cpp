@@ -6,9 +6,18 @@
 #include "../LunettaModula.hpp"
 #include "../inc/Utility.hpp"
 #include "../inc/CMOSInput.hpp"
+#include "../inc/ExpanderCascade.hpp"
 
 // used by mode management includes
 #define MODULE_NAME CD4532
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
+
+#define NUM_DATA_INPUTS 8
+
+// adjacent encoders can be chained into a single encoder of up to 32 inputs
+#define MAX_CASCADE 4
 
 struct CD4532 : Module {
 	enum ParamIds {
@@ -35,18 +44,15 @@ struct CD4532 : Module {
 	// add the variables we'll use when managing modes
 	#include "../modes/modeVariables.hpp"
 	
-	CMOSInput digitalInputs[8];
-	CMOSInput eInput;
+	// the data inputs followed by the enable input
+	CMOSInputBank logicInputs = CMOSInputBank(NUM_INPUTS);
+	float voltages[CMOS_INPUT_BANK_MAX] = {};
+	
+	// the code, group select and enable out as last written to the outputs, -1 forces them all to be rewritten
+	int prevOutputs = -1;
 	
-	// maps 0-7 to binary values - should be quicker than converting
-	const bool outputMmap[8][3] = { {false, false, false},
-									{true, false, false},
-									{false, true, false},
-									{true, true, false},
-									{false, false, true},
-									{true, false, true},
-									{false, true, true},
-									{true, true, true}};
+	// where we sit in the chain, worked out when a neighbour or the cascade option changes
+	CascadeState cascade;
 
 	CD4532() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
@@ -74,19 +80,18 @@ struct CD4532 : Module {
 	}
 	
 	void onReset() override {
-		for (int b = 0; b < 8; b++)
-			digitalInputs[b].reset();
+		logicInputs.reset();
 		
-		eInput.reset();	
+		prevOutputs = -1;
 	}
 	
 	void setIOMode (int mode) {
 		
-		for (int b = 0; b < 8; b++)
-			digitalInputs[b].setMode(mode);
-
-		eInput.setMode(mode);
+		logicInputs.setThresholds(&thresholds);
 
+		// force the outputs to be rewritten at the new gate voltage
+		prevOutputs = -1;
+		
 		// set gate voltage
 		#include "../modes/setGateVoltage.hpp"
 	}	
@@ -95,6 +100,7 @@ struct CD4532 : Module {
 		json_t *root = json_object();
 
 		json_object_set_new(root, "moduleVersion", json_integer(1));
+		json_object_set_new(root, "cascade", json_boolean(cascade.enabled));
 
 		// add the I/O mode details
 		#include "../modes/dataToJson.hpp"		
@@ -104,63 +110,110 @@ struct CD4532 : Module {
 	
 	void dataFromJson(json_t *root) override {
 		
+		json_t *jsonCascade = json_object_get(root, "cascade");
+		cascade.enabled = jsonCascade ? json_boolean_value(jsonCascade) : false;
+		cascade.changed = true;
+		
 		// grab the I/O mode details
 		#include "../modes/dataFromJson.hpp"
 	}	
 
+	static CascadeState *cascadeOf(Module *m) {
+		return (m && m->model == modelCD4532) ? &static_cast<CD4532*>(m)->cascade : NULL;
+	}
+	
+	void onExpanderChange(const ExpanderChangeEvent &e) override {
+		updateCascade(this, cascadeOf, MAX_CASCADE);
+	}
+
 	void process(const ProcessArgs &args) override {
+		if (cascade.changed)
+			updateCascade(this, cascadeOf, MAX_CASCADE);
+		
+		// when we're part of a chain the encoder at its head does all the work
+		if (cascade.offset > 0)
+			return;
+		
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
 
-		if (eInput.process(inputs[E_INPUT].getVoltage())) {
-			bool groupSelect = false;
-			int priority = 0;
-			for (int b = 7; b >= 0; b--) {
-				if (digitalInputs[b].process(inputs[DIGITAL_INPUTS + b].getVoltage())) {
-					priority = b;
-					groupSelect = true;
-					break;
-				}
-			}
+	// data inputs as the low 8 bits followed by the enable input
+	int readWord() {
+		for (int i = 0; i < NUM_INPUTS; i++)
+			voltages[i] = inputs[i].getVoltage();
+		
+		return logicInputs.process(voltages);
+	}
 
-			for (int i = 0; i < 3; i++) {
-				bool out = groupSelect ? outputMmap[priority][i] : false;
-				
-				if (out) {
-					outputs[BIN_OUPUTS + i].setVoltage(gateVoltage);
-					lights[BIN_LIGHTS + i].setBrightness(1.0f);
-				}
-				else {
-					outputs[BIN_OUPUTS + i].setVoltage(0.0f);
-					lights[BIN_LIGHTS + i].setBrightness(0.0f);
-				}
-			}
+	void processLogic(const ProcessArgs &args) {
+
+		// gather the data inputs of the whole chain into a single word, the head of the chain holding the
+		// highest priority inputs, so the highest active input is found with a single count of the leading zeros
+		CD4532 *chain[MAX_CASCADE];
+		int n = 0;
+		uint32_t data = 0;
+		int enable = 0;
+		for (Module *m = this; cascadeOf(m) && cascadeOf(m)->offset == n; m = m->rightExpander.module) {
+			CD4532 *encoder = static_cast<CD4532*>(m);
+			int word = encoder->readWord();
+			data = (data << NUM_DATA_INPUTS) | (word & 0xFF);
 			
-			if (groupSelect) {
-				outputs[E_OUTPUT].setVoltage(0.0f);
-				lights[E_LIGHT].setBrightness(0.0f);
-				
-				outputs[GS_OUTPUT].setVoltage(gateVoltage);
-				lights[GS_LIGHT].setBrightness(1.0f);
-			}
-			else {
-				outputs[E_OUTPUT].setVoltage(gateVoltage);
-				lights[E_LIGHT].setBrightness(1.0f);
-				
-				outputs[GS_OUTPUT].setVoltage(0.0f);
-				lights[GS_LIGHT].setBrightness(0.0f);
+			// only our own enable input counts, the rest are fed by the enable out of the encoder to their left
+			if (n == 0)
+				enable = word >> NUM_DATA_INPUTS;
+			
+			chain[n++] = encoder;
+		}
+		
+		// the encoder holding the highest active input, encoders to its left see no active inputs and pass
+		// the enable along while those to its right are disabled - just as with a chain of the real chips
+		int code = 0, active = n;
+		if (enable && data) {
+			code = 31 - __builtin_clz(data);
+			active = n - 1 - (code / NUM_DATA_INPUTS);
+		}
+		
+		for (int i = 0; i < n; i++) {
+			int bits = 0;
+			if (enable) {
+				if (i < active)
+					bits = 0x10;
+				else if (i == active)
+					bits = (code & 0x07) | 0x08;
 			}
 			
+			chain[i]->setOutputs(bits, alwaysWriteOutputs());
 		}
-		else {
-			outputs[E_OUTPUT].setVoltage(0.0f);
-			lights[E_LIGHT].setBrightness(0.0f);
-			outputs[GS_OUTPUT].setVoltage(0.0f);
-			lights[GS_LIGHT].setBrightness(0.0f);
+	}
+	
+	// code bits followed by the group select and enable out, only written when they change
+	void setOutputs(int bits, bool force) {
+		int changed = force ? 0x1F : bits ^ prevOutputs;
+		if (changed == 0)
+			return;
 			
-			for (int i = 0; i < 3; i++) {
-				outputs[BIN_OUPUTS + i].setVoltage(0.0f);
-				lights[BIN_LIGHTS + i].setBrightness(0.0f);
+		prevOutputs = bits;
+		
+		for (int i = 0; i < 3; i++) {
+			if ((changed >> i) & 1) {
+				bool q = (bits >> i) & 1;
+				outputs[BIN_OUPUTS + i].setVoltage(boolToGate(q));
+				lights[BIN_LIGHTS + i].setBrightness(boolToLight(q));
 			}
 		}
+		
+		if ((changed >> 3) & 1) {
+			bool gs = (bits >> 3) & 1;
+			outputs[GS_OUTPUT].setVoltage(boolToGate(gs));
+			lights[GS_LIGHT].setBrightness(boolToLight(gs));
+		}
+
+		if ((changed >> 4) & 1) {
+			bool eo = (bits >> 4) & 1;
+			outputs[E_OUTPUT].setVoltage(boolToGate(eo));
+			lights[E_LIGHT].setBrightness(boolToLight(eo));
+		}
 	}
 };
 
@@ -196,18 +249,26 @@ struct CD4532Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 	
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4532 *module = dynamic_cast<CD4532*>(this->module);
 		assert(module);
 
 		// blank separator
 		menu->addChild(new MenuSeparator());
-	
-		// add the I/O mode menu items
-		#include "../modes/modeMenus.hpp"
+		
+		// add the cascade menu item
+		CascadeMenuItem *cascadeMenuItem = createMenuItem<CascadeMenuItem>("Cascade with left neighbour", CHECKMARK(module->cascade.enabled));
+		cascadeMenuItem->cascade = &module->cascade;
+		menu->addChild(cascadeMenuItem);
+		
+		// a chained encoder is driven by the head of the chain so its own settings don't apply
+		if (module->cascade.offset > 0)
+			menu->addChild(createMenuLabel("Driven by the head of the chain"));
+		else {
+			// add the I/O mode menu items
+			#include "../modes/modeMenus.hpp"
+		}
 	}
-#endif	
 };
 
 Model *modelCD4532 = createModel<CD4532, CD4532Widget>("CD4532");
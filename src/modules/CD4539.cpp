@@ -9,6 +9,9 @@
 
 // used by mode management includes
 #define MODULE_NAME CD4539
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 #define NUM_GATES 4
 
@@ -39,12 +42,9 @@ struct CD4539 : Module {
 	// add the variables we'll use when managing modes
 	#include "../modes/modeVariables.hpp"
 	
-	CMOSInput aInputs[NUM_GATES];
-	CMOSInput bInputs[NUM_GATES];
-	CMOSInput eaInput;
-	CMOSInput ebInput;
-	CMOSInput s0Input;
-	CMOSInput s1Input;
+	// every input of each channel as one bank so the unselected inputs are tracked too
+	CMOSInputBank channelInputs[PORT_MAX_CHANNELS];
+	float voltages[CMOS_INPUT_BANK_MAX] = {};
 	
 	CD4539() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
@@ -64,35 +64,22 @@ struct CD4539 : Module {
 		configOutput(A_OUTPUT, "Multiplexer A");
 		configOutput(B_OUTPUT, "Multiplexer B");
 		
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++)
+			channelInputs[c] = CMOSInputBank(NUM_INPUTS);
+		
 		setIOMode(VCVRACK_STANDARD);
 	}
 	
 	void onReset() override {
-		for (int g = 0; g < NUM_GATES; g++) {
-			aInputs[g].reset();
-			bInputs[g].reset();
-		}
-		
-		s0Input.reset();
-		s1Input.reset();
-		
-		eaInput.reset();
-		ebInput.reset();
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++)
+			channelInputs[c].reset();
 	}
 
 	void setIOMode (int mode) {
 		
 		// set CMOS input properties
-		for (int g = 0; g < NUM_GATES; g++) {
-			aInputs[g].setMode(mode);
-			bInputs[g].setMode(mode);
-		}
-		
-		eaInput.setMode(mode);
-		ebInput.setMode(mode);
-	
-		s0Input.setMode(mode);
-		s1Input.setMode(mode);
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++)
+			channelInputs[c].setThresholds(&thresholds);
 	
 		// set gate voltage
 		#include "../modes/setGateVoltage.hpp"
@@ -116,48 +103,42 @@ struct CD4539 : Module {
 	}	
 
 	void process(const ProcessArgs &args) override {
-		
-		// determine selected input
-		int s = 0;
-		if (s0Input.process(inputs[S0_INPUT].getVoltage()))
-			s += 1;
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
 
-		if (s1Input.process(inputs[S1_INPUT].getVoltage()))
-			s += 2;
+	void processLogic(const ProcessArgs &args) {
 		
-		// are we enabled? watch out - enable is active low
-		bool a = !eaInput.process(inputs[EA_INPUT].getVoltage());
-		bool b = !ebInput.process(inputs[EB_INPUT].getVoltage());
-	
-		// grab the input value for channel a if enabled
-		if (a) {
-			a &= aInputs[s].process(inputs[A_INPUTS + s].getVoltage());
-		}
+		int channels = 1;
+		for (int i = 0; i < NUM_INPUTS; i++)
+			channels = std::max(channels, inputs[i].getChannels());
 		
-		// grab the input value for channel b if enabled
-		if (b) {
-			b &= bInputs[s].process(inputs[B_INPUTS + s].getVoltage());
-		}
-	
-		// output channel a
-		if (a) {
-			outputs[A_OUTPUT].setVoltage(gateVoltage);
-			lights[A_LIGHT].setBrightness(1.0f);
-		}
-		else {
-			outputs[A_OUTPUT].setVoltage(0.0f);
-			lights[A_LIGHT].setBrightness(0.0f);
-		}
-
-		// output channel b
-		if (b) {
-			outputs[B_OUTPUT].setVoltage(gateVoltage);
-			lights[B_LIGHT].setBrightness(1.0f);
-		}
-		else {
-			outputs[B_OUTPUT].setVoltage(0.0f);
-			lights[B_LIGHT].setBrightness(0.0f);
+		for (int c = 0; c < channels; c++) {
+			// the input ids are already in the order of the bits in the word
+			for (int i = 0; i < NUM_INPUTS; i++)
+				voltages[i] = inputs[i].getPolyVoltage(c);
+			
+			int word = channelInputs[c].process(voltages);
+			
+			// determine selected input
+			int s = (word >> S0_INPUT) & 0x03;
+			
+			// are we enabled? watch out - enable is active low
+			bool a = !((word >> EA_INPUT) & 1) && ((word >> (A_INPUTS + s)) & 1);
+			bool b = !((word >> EB_INPUT) & 1) && ((word >> (B_INPUTS + s)) & 1);
+			
+			outputs[A_OUTPUT].setVoltage(boolToGate(a), c);
+			outputs[B_OUTPUT].setVoltage(boolToGate(b), c);
+			
+			// lights show the first channel
+			if (c == 0) {
+				lights[A_LIGHT].setBrightness(boolToLight(a));
+				lights[B_LIGHT].setBrightness(boolToLight(b));
+			}
 		}
+		
+		outputs[A_OUTPUT].setChannels(channels);
+		outputs[B_OUTPUT].setChannels(channels);
 	}
 };
 
@@ -196,7 +177,6 @@ struct CD4539Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4539 *module = dynamic_cast<CD4539*>(this->module);
 		assert(module);
@@ -207,7 +187,6 @@ struct CD4539Widget : ModuleWidget {
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}
-#endif	
 };
 
 Model *modelCD4539 = createModel<CD4539, CD4539Widget>("CD4539");
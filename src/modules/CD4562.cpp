@@ -6,19 +6,27 @@
 #include "../LunettaModula.hpp"
 #include "../inc/Utility.hpp"
 #include "../inc/CMOSInput.hpp"
+#include "../inc/LogicOversampler.hpp"
 
 // used by mode management includes
 #define MODULE_NAME CD4562
+#define LOGIC_OVERSAMPLING
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 #define NUM_BITS 128
-#define NUM_BITS_LESS_1 127
+#define NUM_BITS_MASK 127
+#define NUM_TAPS 8
 
 struct CD4562 : Module {
 	enum ParamIds {
+		ENUMS(TAP_PARAMS, NUM_TAPS),
 		NUM_PARAMS
 	};
 	enum InputIds {
 		DATA_INPUT,
 		CLOCK_INPUT,
+		TAP_INPUT,
 		NUM_INPUTS
 	};
 	enum OutputIds {
@@ -37,19 +45,30 @@ struct CD4562 : Module {
 	CMOSInput clockInput;
 	bool prevClock = false;
 	
-	bool shiftRegister[NUM_BITS] = {};
-	unsigned int in = NUM_BITS-1;
-	unsigned int out[8] = { 111, 95, 79, 63, 47, 31, 15, 127 };
-
-	int outputLabels[8] = {16, 32, 48, 64, 80, 96, 112, 128};
+	// stages 1-64 in the first word and 65-128 in the second, stage 1 being the least significant bit
+	uint64_t shiftRegister[2] = {};
+	
+	// tap positions (0 based) as set by the parameters
+	int tapStage[NUM_TAPS] = { 15, 31, 47, 63, 79, 95, 111, 127 };
+	int processCount = 8;
+	
+	// the state of the taps when last written
+	int prevTaps = -1;
+	
 	CD4562() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
 		
 		configInput(DATA_INPUT, "Data");
 		configInput(CLOCK_INPUT, "Clock");
+		configInput(TAP_INPUT, "Tap CV");
+		inputInfos[TAP_INPUT]->description = "Moves all taps along the register by 12.8 stages per volt, wrapping around at either end";
 		
-		for (int q = 0; q < 8; q++)
-			configOutput(Q_OUTPUTS + q, rack::string::f("Q%d", outputLabels[q]));
+		for (int q = 0; q < NUM_TAPS; q++) {
+			configParam(TAP_PARAMS + q, 1.0f, (float)NUM_BITS, (float)(16 * (q + 1)), rack::string::f("Tap %d stage", q + 1));
+			paramQuantities[TAP_PARAMS + q]->snapEnabled = true;
+			
+			configOutput(Q_OUTPUTS + q, rack::string::f("Tap %d", q + 1));
+		}
 
 		setIOMode(VCVRACK_STANDARD);
 	}
@@ -58,20 +77,19 @@ struct CD4562 : Module {
 		dataInput.reset();
 		clockInput.reset();
 	
-		for (int i = 0; i < NUM_BITS; i++)
-			shiftRegister[i] = false;
-			
-		for (int b = 0; b < 8; b++) {
-			outputs[Q_OUTPUTS + b].setVoltage(0.0f);
-			lights[Q_LIGHTS + b].setBrightness(0.0f);
-		}
+		shiftRegister[0] = shiftRegister[1] = 0;
+		prevTaps = -1;
+		processCount = 8;
 	}
 	
 	void setIOMode (int mode) {
 		// set CMOS input properties
-		dataInput.setMode(mode);
-		clockInput.setMode(mode);
+		dataInput.setThresholds(&thresholds);
+		clockInput.setThresholds(&thresholds);
 
+		// force the outputs to be rewritten at the new gate voltage
+		prevTaps = -1;
+		
 		// set gate voltage
 		#include "../modes/setGateVoltage.hpp"
 	}	
@@ -94,39 +112,56 @@ struct CD4562 : Module {
 	}	
 
 	void process(const ProcessArgs &args) override {
+		// run the logic at the selected rate and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
 
-		// process the clock
-		bool clock = clockInput.process(inputs[CLOCK_INPUT].getVoltage());
-		
-		if (clock && !prevClock) {
-
-			// grab the data input we want
-			bool data = dataInput.process(inputs[DATA_INPUT].getVoltage());
+	void processLogic(const ProcessArgs &args) {
 
-			// process the shift register here
-			shiftRegister[in++]= data;
-			if (in > NUM_BITS_LESS_1)
-				in = 0;
+		// tap positions don't need reading at audio rate
+		if (++processCount > 8) {
+			processCount = 0;
 			
-			for (int b = 0; b < 8; b++) {
-				if (++out[b] > NUM_BITS_LESS_1)
-					out[b] = 0;
-			}
+			for (int t = 0; t < NUM_TAPS; t++)
+				tapStage[t] = (int)(params[TAP_PARAMS + t].getValue()) - 1;
 		}
+		
+		// process the clock and data
+		bool clock = clockInput.process(inputs[CLOCK_INPUT].getVoltage());
+		uint64_t data = dataInput.process(inputs[DATA_INPUT].getVoltage()) ? 1 : 0;
+		
+		// shift both words on the rising edge of the clock, carrying stage 64 into stage 65
+		uint64_t shift = (clock && !prevClock) ? ~(uint64_t)0 : 0;
+		uint64_t hi = (shiftRegister[1] << 1) | (shiftRegister[0] >> 63);
+		uint64_t lo = (shiftRegister[0] << 1) | data;
+		shiftRegister[1] ^= (shiftRegister[1] ^ hi) & shift;
+		shiftRegister[0] ^= (shiftRegister[0] ^ lo) & shift;
+		prevClock = clock;
 
-		// data outputs
-		for (int b = 0; b < 8; b++) {
-			if (shiftRegister[out[b]]) {
-				outputs[Q_OUTPUTS + b].setVoltage(gateVoltage);
-				lights[Q_LIGHTS + b].setBrightness(1.0f);
-			}
-			else {
-				outputs[Q_OUTPUTS + b].setVoltage(0.0f);
-				lights[Q_LIGHTS + b].setBrightness(0.0f);
+		// gather all taps into a single mask
+		int offset = (int)(inputs[TAP_INPUT].getVoltage() * 12.8f);
+		int taps = 0;
+		for (int t = 0; t < NUM_TAPS; t++) {
+			int stage = (tapStage[t] + offset) & NUM_BITS_MASK;
+			taps |= (int)((shiftRegister[stage >> 6] >> (stage & 63)) & 1) << t;
+		}
+		
+		// and only update the outputs that have changed
+		int changed = taps ^ prevTaps;
+		if (alwaysWriteOutputs())
+			changed = 0xFF;
+			
+		if (changed) {
+			prevTaps = taps;
+			
+			for (int t = 0; t < NUM_TAPS; t++) {
+				if ((changed >> t) & 1) {
+					bool q = (taps >> t) & 1;
+					outputs[Q_OUTPUTS + t].setVoltage(boolToGate(q));
+					lights[Q_LIGHTS + t].setBrightness(boolToLight(q));
+				}
 			}
 		}
-
-		prevClock = clock;
 	}
 };
 
@@ -141,6 +176,7 @@ struct CD4562Widget : ModuleWidget {
 		// inputs
 		addInput(createInputCentered<LunettaModulaLogicInputJack>(Vec(STD_COLUMN_POSITIONS[STD_COL1], STD_ROWS8[STD_ROW3]), module, CD4562::CLOCK_INPUT));
 		addInput(createInputCentered<LunettaModulaLogicInputJack>(Vec(STD_COLUMN_POSITIONS[STD_COL1], STD_ROWS8[STD_ROW6]), module, CD4562::DATA_INPUT));
+		addInput(createInputCentered<LunettaModulaAnalogInputJack>(Vec(STD_COLUMN_POSITIONS[STD_COL1], STD_ROWS8[STD_ROW8]), module, CD4562::TAP_INPUT));
 
 		// Q outputs
 		for (int b = 0; b < 8; b++) {
@@ -152,7 +188,6 @@ struct CD4562Widget : ModuleWidget {
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		CD4562 *module = dynamic_cast<CD4562*>(this->module);
 		assert(module);
@@ -160,10 +195,18 @@ struct CD4562Widget : ModuleWidget {
 		// blank separator
 		menu->addChild(new MenuSeparator());
 		
+		// the tap positions have no room on the panel so they live here
+		menu->addChild(createMenuLabel("Tap Positions"));
+		for (int t = 0; t < NUM_TAPS; t++) {
+			ui::Slider *tapSlider = new ui::Slider;
+			tapSlider->quantity = module->paramQuantities[CD4562::TAP_PARAMS + t];
+			tapSlider->box.size.x = 200.0f;
+			menu->addChild(tapSlider);
+		}
+		
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}	
-#endif	
 };
 
 Model *modelCD4562 = createModel<CD4562, CD4562Widget>("CD4562");
@@ -33,7 +33,8 @@ struct DAC : Module {
 	// add the variables we'll use when managing modes
 	#include "../modes/modeVariables.hpp"
 	
-	CMOSInput digitalInputs[8];
+	// one set of inputs per channel so each word has its own hysteresis
+	CMOSInput digitalInputs[8][PORT_MAX_CHANNELS];
 	
 	int prevDigitalValue = -1;
 	int bits = 8, prevBits = 2;
@@ -41,9 +42,18 @@ struct DAC : Module {
 	float offset = 0.0f, prevOffset = 0.0f;
 	
 	int processCount = 8;
-	float analogeValue = 0.0f;
-	float displayValue = 0.0f;
 	
+	// output voltage for every possible input word, rebuilt only when the bits, scale or offset change
+	float voltageTable[256] = {};
+	
+	// the current input word for each channel
+	int digitalValue[PORT_MAX_CHANNELS] = {};
+	
+	// optional slew on the analogue output
+	float slewTime = 0.0f;
+	float slewCoeff = 1.0f;
+	float slewSampleTime = 0.0f;
+	simd::float_4 slewValue[PORT_MAX_CHANNELS / 4] = {};
 	
 	const int bitmap[8] = { 1, 2, 4, 8, 16, 32, 64, 128 };
 
@@ -67,19 +77,25 @@ struct DAC : Module {
 
 		setIOMode(VCVRACK_STANDARD);
 		
-		analogeValue = 0.0f;
-		displayValue = 0.0f;
+		buildVoltageTable();
 	}
 	
 	void onReset() override {
-		for (int b = 0; b < 8; b++)
-			digitalInputs[b].reset();
+		for (int b = 0; b < 8; b++) {
+			for (int c = 0; c < PORT_MAX_CHANNELS; c++)
+				digitalInputs[b][c].reset();
+		}
+		
+		for (int g = 0; g < PORT_MAX_CHANNELS / 4; g++)
+			slewValue[g] = 0.0f;
 	}
 	
 	void setIOMode (int mode) {
 		
-		for (int b = 0; b < 8; b++)
-			digitalInputs[b].setMode(mode);
+		for (int b = 0; b < 8; b++) {
+			for (int c = 0; c < PORT_MAX_CHANNELS; c++)
+				digitalInputs[b][c].setThresholds(&thresholds);
+		}
 
 		// set gate voltage
 		#include "../modes/setGateVoltage.hpp"
@@ -89,6 +105,7 @@ struct DAC : Module {
 		json_t *root = json_object();
 
 		json_object_set_new(root, "moduleVersion", json_integer(1));
+		json_object_set_new(root, "slewTime", json_real(slewTime));
 
 		// add the I/O mode details
 		#include "../modes/dataToJson.hpp"		
@@ -98,20 +115,41 @@ struct DAC : Module {
 	
 	void dataFromJson(json_t *root) override {
 		
+		json_t *jsonSlewTime = json_object_get(root, "slewTime");
+		setSlewTime(jsonSlewTime ? json_number_value(jsonSlewTime) : 0.0f);
+		
 		// grab the I/O mode details
 		#include "../modes/dataFromJson.hpp"
 	}	
 
+	void setSlewTime(float t) {
+		slewTime = std::max(t, 0.0f);
+		
+		// force the coefficient to be recalculated
+		slewSampleTime = 0.0f;
+	}
+	
+	// the output voltage for each possible word at the current settings
+	void buildVoltageTable() {
+		float bitVoltage = vRef / maxBits[bits];
+		
+		for (int i = 0; i < 256; i++)
+			voltageTable[i] = vRef > 0.0f ? clamp(bitVoltage * (float)i + offset, 0.0f, 12.0f) : 0.0f;
+	}
+
 	void process(const ProcessArgs &args) override {
 
 		// determine bit depth and bit voltage to use - no need to do this at audio rate
 		if (++processCount > 8) {
+			processCount = 0;
+			
 			bits = clamp((int)(params[BITS_PARAM].getValue()), 2, 8);
 			vRef = clamp(params[SCALE_PARAM].getValue(), 0.0f, 10.0f);
 			offset = params[OFFSET_PARAM].getValue();
 			
-			// force update of output on change of parameter
+			// rebuild the table on change of parameter
 			if (prevBits != bits || vRef != prevVRef || offset != prevOffset) {
+				buildVoltageTable();
 				prevDigitalValue = -1;
 				
 				prevOffset = offset;
@@ -120,28 +158,47 @@ struct DAC : Module {
 			}
 		}
 		
+		// one word per channel, a monophonic bit input is shared by all words
+		int channels = 1;
+		for (int b = 0; b < bits; b++)
+			channels = std::max(channels, inputs[DIGITAL_INPUTS + b].getChannels());
+		
 		// process the input bits
-		if (vRef > 0.0f) {
-			int digitalValue = 0;
+		for (int c = 0; c < channels; c++) {
+			int word = 0;
 			for (int b = 0; b < bits; b++) {
-				if (digitalInputs[b].process(inputs[DIGITAL_INPUTS + b].getVoltage()))
-					digitalValue += bitmap[b];
-			}
-			
-			if (digitalValue != prevDigitalValue) {
-				prevDigitalValue = digitalValue;
-				analogeValue = (vRef / maxBits[bits] * (float)digitalValue);
-				displayValue = analogeValue / vRef;
-				lights[ANALOGUE_LIGHT].setBrightness(displayValue);
+				if (digitalInputs[b][c].process(inputs[DIGITAL_INPUTS + b].getPolyVoltage(c)))
+					word += bitmap[b];
 			}
 			
-			outputs[ANALOGUE_OUPUT].setVoltage(clamp(analogeValue + offset, 0.0f, 12.0f));
+			digitalValue[c] = word;
+		}
+		
+		// the light follows the first word
+		if (digitalValue[0] != prevDigitalValue) {
+			prevDigitalValue = digitalValue[0];
+			lights[ANALOGUE_LIGHT].setBrightness(vRef > 0.0f ? (float)prevDigitalValue / maxBits[bits] : 0.0f);
+		}
+		
+		// convert 4 words at a time
+		if (slewTime > 0.0f && args.sampleTime != slewSampleTime) {
+			slewSampleTime = args.sampleTime;
+			slewCoeff = 1.0f - std::exp(-args.sampleTime / slewTime);
 		}
-		else {
-			if (processCount == 0) {
-				outputs[ANALOGUE_OUPUT].setVoltage(0.0f);
-				lights[ANALOGUE_LIGHT].setBrightness(0.0f);
+		
+		outputs[ANALOGUE_OUPUT].setChannels(channels);
+		for (int c = 0; c < channels; c += 4) {
+			const int *w = &digitalValue[c];
+			simd::float_4 v = simd::float_4(voltageTable[w[0]], voltageTable[w[1]], voltageTable[w[2]], voltageTable[w[3]]);
+			
+			if (slewTime > 0.0f) {
+				slewValue[c / 4] += slewCoeff * (v - slewValue[c / 4]);
+				v = slewValue[c / 4];
 			}
+			else
+				slewValue[c / 4] = v;
+			
+			outputs[ANALOGUE_OUPUT].setVoltageSimd(v, c);
 		}
 	}
 };
@@ -168,10 +225,40 @@ struct DACWidget : ModuleWidget {
 		addChild(createLightCentered<SmallLight<RedLight>>(Vec(STD_COLUMN_POSITIONS[STD_COL3] + 12, STD_ROWS8[STD_ROW7] - 19), module, DAC::ANALOGUE_LIGHT));
 	}
 	
+	// output slew menu item
+	struct SlewMenuItem : MenuItem {
+		DAC *module;
+		float slewTime;
+		
+		void onAction(const event::Action &e) override {
+			module->setSlewTime(slewTime);
+		}
+	};
+	
+	// output slew menu
+	struct SlewMenu : MenuItem {
+		DAC *module;
+		
+		Menu *createChildMenu() override {
+			Menu *menu = new Menu;
+
+			const float times[6] = {0.0f, 0.001f, 0.005f, 0.01f, 0.05f, 0.1f};
+			const std::string labels[6] = {"Off", "1ms", "5ms", "10ms", "50ms", "100ms"};
+			
+			for (int i = 0; i < 6; i++) {
+				SlewMenuItem *slewMenuItem = createMenuItem<SlewMenuItem>(labels[i], CHECKMARK(module->slewTime == times[i]));
+				slewMenuItem->module = module;
+				slewMenuItem->slewTime = times[i];
+				menu->addChild(slewMenuItem);
+			}
+			
+			return menu;	
+		}
+	};
+	
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 	
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		DAC *module = dynamic_cast<DAC*>(this->module);
 		assert(module);
@@ -179,10 +266,14 @@ struct DACWidget : ModuleWidget {
 		// blank separator
 		menu->addChild(new MenuSeparator());
 	
+		// add the output slew menu item
+		SlewMenu *slewMenuItem = createMenuItem<SlewMenu>("Output Slew", RIGHT_ARROW);
+		slewMenuItem->module = module;
+		menu->addChild(slewMenuItem);
+		
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}
-#endif	
 };
 
 Model *modelDAC = createModel<DAC, DACWidget>("DAC");
@@ -9,11 +9,16 @@
 
 // used by mode management includes
 #define MODULE_NAME MC14530
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 #define NUM_GATES 5
 
 struct MC14530 : Module {
 	enum ParamIds {
+		THRESHOLD_A_PARAM,
+		THRESHOLD_B_PARAM,
 		NUM_PARAMS
 	};
 	enum InputIds {
@@ -37,14 +42,24 @@ struct MC14530 : Module {
 	// add the variables we'll use when managing modes
 	#include "../modes/modeVariables.hpp"
 	
-	CMOSInput aInputs[NUM_GATES];
-	CMOSInput bInputs[NUM_GATES];
-	CMOSInput waInput;
-	CMOSInput wbInput;
+	// state of each input for each group of 4 channels as SIMD masks
+	simd::float_4 aStates[NUM_GATES][PORT_MAX_CHANNELS / 4];
+	simd::float_4 bStates[NUM_GATES][PORT_MAX_CHANNELS / 4];
+	simd::float_4 waStates[PORT_MAX_CHANNELS / 4];
+	simd::float_4 wbStates[PORT_MAX_CHANNELS / 4];
+	
+	// gate A counts the B inputs as well as its own
+	bool combined = false;
 	
 	MC14530() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
 		
+		// the standard majority gate is 3 of 5
+		configParam(THRESHOLD_A_PARAM, 1.0f, (float)(NUM_GATES * 2), 3.0f, "Gate A threshold");
+		configParam(THRESHOLD_B_PARAM, 1.0f, (float)NUM_GATES, 3.0f, "Gate B threshold");
+		paramQuantities[THRESHOLD_A_PARAM]->snapEnabled = true;
+		paramQuantities[THRESHOLD_B_PARAM]->snapEnabled = true;
+		
 		char c = 'A';
 		for (int i = 0; i < NUM_GATES; i++) {
 			configInput(A_INPUTS + i, rack::string::f("Gate A logic %c", c));
@@ -57,29 +72,26 @@ struct MC14530 : Module {
 		configOutput(ZA_OUTPUT, "Gate A Z");
 		configOutput(ZB_OUTPUT, "Gate B Z");
 		
+		onReset();
+		
 		setIOMode(VCVRACK_STANDARD);
 	}
 	
 	void onReset() override {
-		for (int g = 0; g < NUM_GATES; g++) {
-			aInputs[g].reset();
-			bInputs[g].reset();
+		for (int c = 0; c < PORT_MAX_CHANNELS / 4; c++) {
+			for (int g = 0; g < NUM_GATES; g++) {
+				aStates[g][c] = simd::float_4::zero();
+				bStates[g][c] = simd::float_4::zero();
+			}
+			
+			waStates[c] = simd::float_4::zero();
+			wbStates[c] = simd::float_4::zero();
 		}
-		
-		waInput.reset();
-		wbInput.reset();
 	}
 
 	void setIOMode (int mode) {
 		
-		// set CMOS input properties
-		for (int g = 0; g < NUM_GATES; g++) {
-			aInputs[g].setMode(mode);
-			bInputs[g].setMode(mode);
-		}
-		
-		waInput.setMode(mode);
-		wbInput.setMode(mode);
+		// the inputs are modelled in the logic using the module's thresholds
 		
 		// set gate voltage
 		#include "../modes/setGateVoltage.hpp"
@@ -89,6 +101,7 @@ struct MC14530 : Module {
 		json_t *root = json_object();
 
 		json_object_set_new(root, "moduleVersion", json_integer(1));
+		json_object_set_new(root, "combined", json_boolean(combined));
 		
 		// add the I/O mode details
 		#include "../modes/dataToJson.hpp"		
@@ -98,42 +111,73 @@ struct MC14530 : Module {
 	
 	void dataFromJson(json_t *root) override {
 
+		json_t *jsonCombined = json_object_get(root, "combined");
+		combined = jsonCombined ? json_boolean_value(jsonCombined) : false;
+		
 		// grab the I/O mode details
 		#include "../modes/dataFromJson.hpp"
 	}	
 
 	void process(const ProcessArgs &args) override {
-		
-		int a = 0, b = 0;
-		for (int g = 0; g < NUM_GATES; g++) {
-			
-			if (aInputs[g].process(inputs[A_INPUTS + g].getVoltage()))
-				a++;
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
 
-			if (bInputs[g].process(inputs[B_INPUTS + g].getVoltage()))
-				b++;
-		}
-	
-		bool za = waInput.process(inputs[WA_INPUT].getNormalVoltage(gateVoltage)) == (a > 2);
-		bool zb = wbInput.process(inputs[WB_INPUT].getNormalVoltage(gateVoltage)) == (b > 2);
-	
-		if (za) {
-			outputs[ZA_OUTPUT].setVoltage(gateVoltage);
-			lights[ZA_LIGHT].setBrightness(1.0f);
-		}
-		else {
-			outputs[ZA_OUTPUT].setVoltage(0.0f);
-			lights[ZA_LIGHT].setBrightness(0.0f);
-		}
+	// update the state of an input for a group of 4 channels and return 1 for each channel that is high
+	inline simd::float_4 processInput(simd::float_4 &state, simd::float_4 v, simd::float_4 vLow, simd::float_4 vHigh) {
+		state = simd::ifelse(state, v > vLow, v >= vHigh);
+		return simd::ifelse(state, simd::float_4(1.0f), simd::float_4::zero());
+	}
 
-		if (zb) {
-			outputs[ZB_OUTPUT].setVoltage(gateVoltage);
-			lights[ZB_LIGHT].setBrightness(1.0f);
-		}
-		else {
-			outputs[ZB_OUTPUT].setVoltage(0.0f);
-			lights[ZB_LIGHT].setBrightness(0.0f);
+	void processLogic(const ProcessArgs &args) {
+		
+		int channels = 1;
+		for (int i = 0; i < NUM_INPUTS; i++)
+			channels = std::max(channels, inputs[i].getChannels());
+		
+		simd::float_4 vLow = thresholds.vLow;
+		simd::float_4 vHigh = thresholds.vHigh;
+		
+		simd::float_4 thresholdA = params[THRESHOLD_A_PARAM].getValue();
+		simd::float_4 thresholdB = params[THRESHOLD_B_PARAM].getValue();
+
+		// W is normally high, leaving the outputs true when the threshold is met
+		simd::float_4 high = gateVoltage;
+		
+		// count the high inputs of 4 channels at a time - every input is counted whether it is patched or not
+		// so the cost is the same however many are in use
+		for (int c = 0; c < channels; c += 4) {
+			int g = c >> 2;
+			
+			simd::float_4 a = simd::float_4::zero();
+			simd::float_4 b = simd::float_4::zero();
+			for (int i = 0; i < NUM_GATES; i++) {
+				a += processInput(aStates[i][g], inputs[A_INPUTS + i].getPolyVoltageSimd<simd::float_4>(c), vLow, vHigh);
+				b += processInput(bStates[i][g], inputs[B_INPUTS + i].getPolyVoltageSimd<simd::float_4>(c), vLow, vHigh);
+			}
+			
+			if (combined)
+				a += b;
+			
+			simd::float_4 wa = processInput(waStates[g], inputs[WA_INPUT].isConnected() ? inputs[WA_INPUT].getPolyVoltageSimd<simd::float_4>(c) : high, vLow, vHigh);
+			simd::float_4 wb = processInput(wbStates[g], inputs[WB_INPUT].isConnected() ? inputs[WB_INPUT].getPolyVoltageSimd<simd::float_4>(c) : high, vLow, vHigh);
+			
+			// Z is high when the threshold being met agrees with W
+			simd::float_4 za = simd::ifelse(a >= thresholdA, wa, 1.0f - wa);
+			simd::float_4 zb = simd::ifelse(b >= thresholdB, wb, 1.0f - wb);
+			
+			outputs[ZA_OUTPUT].setVoltageSimd(za * gateVoltage, c);
+			outputs[ZB_OUTPUT].setVoltageSimd(zb * gateVoltage, c);
+			
+			// lights show the first channel
+			if (c == 0) {
+				lights[ZA_LIGHT].setBrightness(za[0]);
+				lights[ZB_LIGHT].setBrightness(zb[0]);
+			}
 		}
+		
+		outputs[ZA_OUTPUT].setChannels(channels);
+		outputs[ZB_OUTPUT].setChannels(channels);
 	}
 };
 
@@ -165,10 +209,18 @@ struct MC14530Widget : ModuleWidget {
 		addChild(createLightCentered<SmallLight<RedLight>>(Vec(STD_COLUMN_POSITIONS[STD_COL3] + 12, STD_ROWS7[STD_ROW7] - 19), module, MC14530::ZB_LIGHT));
 	}
 
+	// combined gate menu item
+	struct CombinedMenuItem : MenuItem {
+		MC14530 *module;
+		
+		void onAction(const event::Action &e) override {
+			module->combined ^= true;
+		}
+	};
+	
 	// include the I/O mode menu item struct we'll need when we add the theme menu items
 	#include "../modes/modeMenuItem.hpp"
 
-#ifdef CMOS_MODEL_ENABLED
 	void appendContextMenu(Menu *menu) override {
 		MC14530 *module = dynamic_cast<MC14530*>(this->module);
 		assert(module);
@@ -176,10 +228,25 @@ struct MC14530Widget : ModuleWidget {
 		// blank separator
 		menu->addChild(new MenuSeparator());
 		
+		// the thresholds are set and forget options so they live here
+		for (int g = 0; g < 2; g++) {
+			ui::Slider *thresholdSlider = new ui::Slider;
+			thresholdSlider->quantity = module->paramQuantities[MC14530::THRESHOLD_A_PARAM + g];
+			thresholdSlider->box.size.x = 200.0f;
+			menu->addChild(thresholdSlider);
+		}
+		
+		// add the combined gate menu item
+		CombinedMenuItem *combinedMenuItem = createMenuItem<CombinedMenuItem>("Gate A counts B inputs", CHECKMARK(module->combined));
+		combinedMenuItem->module = module;
+		menu->addChild(combinedMenuItem);
+		
+		// blank separator
+		menu->addChild(new MenuSeparator());
+		
 		// add the I/O mode menu items
 		#include "../modes/modeMenus.hpp"
 	}
-#endif	
 };
 
 Model *modelMC14530 = createModel<MC14530, MC14530Widget>("MC14530");
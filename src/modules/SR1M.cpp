@@ -0,0 +1,335 @@
+//----------------------------------------------------------------------------
+//	Lunetta Modula Plugin for VCV Rack by Count Modula - SR1M
+//	1M Stage Shift Register
+//  Copyright (C) 2026  Adam Verspaget
+//----------------------------------------------------------------------------
+#include "../LunettaModula.hpp"
+#include "../inc/Utility.hpp"
+#include "../inc/CMOSInput.hpp"
+#include "../inc/LogicOversampler.hpp"
+#include "../inc/MappedFile.hpp"
+
+// used by mode management includes
+#define MODULE_NAME SR1M
+#define LOGIC_OVERSAMPLING
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
+
+#define SR1M_MAX_LENGTH_BITS 20
+#define SR1M_MAX_LENGTH (1 << SR1M_MAX_LENGTH_BITS)
+#define SR1M_POSITION_MASK (SR1M_MAX_LENGTH - 1)
+#define SR1M_NUM_WORDS (SR1M_MAX_LENGTH / 64)
+#define SR1M_NUM_TAPS 4
+
+// side file holding the register contents, saved alongside the patch rather than in the json
+#define SR1M_FILE_NAME "register.bin"
+#define SR1M_FILE_MAGIC 0x4D315253 // "SR1M"
+#define SR1M_FILE_VERSION 1
+
+struct SR1MFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t position;
+	uint32_t filled;
+	uint32_t numWords;
+};
+
+// shows the length knob as the whole number of stages actually in use
+struct SR1MLengthQuantity : ParamQuantity {
+	std::string getDisplayValueString() override {
+		return string::f("%d", clamp((int)std::exp2(getValue()), 1, SR1M_MAX_LENGTH));
+	}
+
+	void setDisplayValueString(std::string s) override {
+		float stages = std::atof(s.c_str());
+		if (stages >= 1.0f)
+			setValue(std::log2(stages));
+	}
+};
+
+struct SR1M : Module {
+	enum ParamIds {
+		LENGTH_PARAM,
+		NUM_PARAMS
+	};
+	enum InputIds {
+		CLOCK_INPUT,
+		DATA_INPUT,
+		LOOP_INPUT,
+		LENGTH_INPUT,
+		NUM_INPUTS
+	};
+	enum OutputIds {
+		ENUMS(TAP_OUTPUTS, SR1M_NUM_TAPS),
+		NUM_OUTPUTS
+	};
+	enum LightIds {
+		ENUMS(TAP_LIGHTS, SR1M_NUM_TAPS),
+		NUM_LIGHTS
+	};
+
+	// add the variables we'll use when managing modes
+	#include "../modes/modeVariables.hpp"
+
+	CMOSInput clockInput;
+	CMOSInput dataInput;
+	CMOSInput loopInput;
+
+	bool prevClock = false;
+
+	// the register is a ring of bits - stage 1 lives at the write position and stage n sits n-1 bits behind
+	// it so a clock only ever touches a single bit no matter how long the register is
+	std::vector<uint64_t> shiftRegister;
+	uint32_t position = 0;
+
+	// number of stages clocked in since the register was cleared, used to keep the side file small
+	uint32_t filled = 0;
+
+	// length and tap stages, only recalculated when the length knob or CV moves
+	float prevLengthValue = -1.0f;
+	int length = 1;
+	int tapStages[SR1M_NUM_TAPS] = {};
+
+	// the state of the taps when last written
+	int prevTaps = -1;
+
+	SR1M() {
+		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+
+		configParam<SR1MLengthQuantity>(LENGTH_PARAM, 0.0f, (float)SR1M_MAX_LENGTH_BITS, 4.0f, "Length", " stages");
+
+		configInput(CLOCK_INPUT, "Clock");
+		configInput(DATA_INPUT, "Data");
+		configInput(LOOP_INPUT, "Loop");
+		inputInfos[LOOP_INPUT]->description = "High to recirculate the last stage instead of the data input";
+		configInput(LENGTH_INPUT, "Length CV");
+		inputInfos[LENGTH_INPUT]->description = "Doubles the length for each volt";
+
+		configOutput(TAP_OUTPUTS, "1/4 length");
+		configOutput(TAP_OUTPUTS + 1, "1/2 length");
+		configOutput(TAP_OUTPUTS + 2, "3/4 length");
+		configOutput(TAP_OUTPUTS + 3, "Last stage");
+
+		shiftRegister.resize(SR1M_NUM_WORDS, 0);
+
+		setIOMode(VCVRACK_STANDARD);
+	}
+
+	void onReset() override {
+		clockInput.reset();
+		dataInput.reset();
+		loopInput.reset();
+
+		prevClock = false;
+
+		clearRegister();
+		prevTaps = -1;
+	}
+
+	void clearRegister() {
+		std::fill(shiftRegister.begin(), shiftRegister.end(), 0);
+		position = 0;
+		filled = 0;
+	}
+
+	void setIOMode (int mode) {
+		// set CMOS input properties
+		clockInput.setThresholds(&thresholds);
+		dataInput.setThresholds(&thresholds);
+		loopInput.setThresholds(&thresholds);
+
+		// force the taps to be rewritten at the new gate voltage
+		prevTaps = -1;
+
+		// set gate voltage
+		#include "../modes/setGateVoltage.hpp"
+	}
+
+	json_t *dataToJson() override {
+		json_t *root = json_object();
+
+		json_object_set_new(root, "moduleVersion", json_integer(1));
+
+		// add the I/O mode details
+		#include "../modes/dataToJson.hpp"
+
+		return root;
+	}
+
+	void dataFromJson(json_t *root) override {
+
+		// grab the I/O mode details
+		#include "../modes/dataFromJson.hpp"
+	}
+
+	// the register contents are far too big for the json so they go in the patch storage directory. Only the
+	// words holding stages that have been clocked in are written, oldest first, ending with the current one.
+	void onSave(const SaveEvent &e) override {
+		std::string path = system::join(createPatchStorageDirectory(), SR1M_FILE_NAME);
+
+		if (filled == 0) {
+			system::remove(path);
+			return;
+		}
+
+		SR1MFileHeader header;
+		header.magic = SR1M_FILE_MAGIC;
+		header.version = SR1M_FILE_VERSION;
+		header.position = position;
+		header.filled = filled;
+		header.numWords = std::min((uint32_t)SR1M_NUM_WORDS, (filled + 63) / 64 + 1);
+
+		FILE *file = fopen(path.c_str(), "wb");
+		if (!file)
+			return;
+
+		fwrite(&header, sizeof(header), 1, file);
+
+		// the used words may wrap around the end of the ring so write them in at most two runs
+		uint32_t first = ((position >> 6) - header.numWords + 1) & (SR1M_NUM_WORDS - 1);
+		uint32_t run = std::min(header.numWords, SR1M_NUM_WORDS - first);
+		fwrite(&shiftRegister[first], sizeof(uint64_t), run, file);
+		if (run < header.numWords)
+			fwrite(&shiftRegister[0], sizeof(uint64_t), header.numWords - run, file);
+
+		fclose(file);
+	}
+
+	// called once the module has been added to the engine, after the json has been loaded
+	void onAdd(const AddEvent &e) override {
+		std::string path = system::join(getPatchStorageDirectory(), SR1M_FILE_NAME);
+
+		// no file is fine - the patch may never have been saved or the register was empty
+		MappedFile file;
+		if (!file.open(path) || file.size < sizeof(SR1MFileHeader))
+			return;
+
+		SR1MFileHeader header;
+		std::memcpy(&header, file.data, sizeof(header));
+
+		if (header.magic != SR1M_FILE_MAGIC || header.version != SR1M_FILE_VERSION)
+			return;
+
+		if (header.numWords == 0 || header.numWords > SR1M_NUM_WORDS || file.size < sizeof(header) + header.numWords * sizeof(uint64_t))
+			return;
+
+		clearRegister();
+
+		position = header.position & SR1M_POSITION_MASK;
+		filled = std::min(header.filled, (uint32_t)SR1M_MAX_LENGTH);
+
+		const uint8_t *words = file.data + sizeof(header);
+		uint32_t first = ((position >> 6) - header.numWords + 1) & (SR1M_NUM_WORDS - 1);
+		uint32_t run = std::min(header.numWords, SR1M_NUM_WORDS - first);
+		std::memcpy(&shiftRegister[first], words, run * sizeof(uint64_t));
+		if (run < header.numWords)
+			std::memcpy(&shiftRegister[0], words + run * sizeof(uint64_t), (header.numWords - run) * sizeof(uint64_t));
+	}
+
+	void process(const ProcessArgs &args) override {
+		// run the logic at the selected rate and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
+
+	// state of the given stage, 1 being the most recent
+	inline int stage(int n) {
+		uint32_t p = (position - (uint32_t)(n - 1)) & SR1M_POSITION_MASK;
+		return (int)((shiftRegister[p >> 6] >> (p & 63)) & 1);
+	}
+
+	void processLogic(const ProcessArgs &args) {
+
+		// each volt of CV doubles the length so the whole range is within reach
+		float lengthValue = params[LENGTH_PARAM].getValue() + inputs[LENGTH_INPUT].getVoltage();
+		if (lengthValue != prevLengthValue) {
+			prevLengthValue = lengthValue;
+			length = clamp((int)std::exp2(lengthValue), 1, SR1M_MAX_LENGTH);
+
+			for (int t = 0; t < SR1M_NUM_TAPS; t++)
+				tapStages[t] = std::max(1, (length * (t + 1)) / SR1M_NUM_TAPS);
+		}
+
+		bool loop = loopInput.process(inputs[LOOP_INPUT].getVoltage());
+		bool data = dataInput.process(inputs[DATA_INPUT].getVoltage());
+		bool clock = clockInput.process(inputs[CLOCK_INPUT].getVoltage());
+
+		// clock in the new stage 1, overwriting the oldest bit in the ring
+		if (clock && !prevClock) {
+			if (loop)
+				data = stage(length);
+
+			position = (position + 1) & SR1M_POSITION_MASK;
+
+			uint64_t bit = (uint64_t)1 << (position & 63);
+			uint64_t &word = shiftRegister[position >> 6];
+			word = data ? (word | bit) : (word & ~bit);
+
+			if (filled < SR1M_MAX_LENGTH)
+				filled++;
+		}
+
+		prevClock = clock;
+
+		// tap outputs - only written when they change
+		int taps = 0;
+		for (int t = 0; t < SR1M_NUM_TAPS; t++)
+			taps |= stage(tapStages[t]) << t;
+
+		int changed = alwaysWriteOutputs() ? ~0 : taps ^ prevTaps;
+		if (changed) {
+			prevTaps = taps;
+
+			for (int t = 0; t < SR1M_NUM_TAPS; t++) {
+				if ((changed >> t) & 1) {
+					bool q = (taps >> t) & 1;
+					outputs[TAP_OUTPUTS + t].setVoltage(boolToGate(q));
+					lights[TAP_LIGHTS + t].setBrightness(boolToLight(q));
+				}
+			}
+		}
+	}
+};
+
+struct SR1MWidget : ModuleWidget {
+	SR1MWidget(SR1M *module) {
+		setModule(module);
+		setPanel(APP->window->loadSvg(asset::plugin(pluginInstance, "res/SR1M.svg")));
+
+		// screws
+		#include "../components/stdScrews.hpp"
+
+		// inputs
+		addInput(createInputCentered<LunettaModulaLogicInputJack>(Vec(STD_COLUMN_POSITIONS[STD_COL1], STD_ROWS5[STD_ROW1]), module, SR1M::CLOCK_INPUT));
+		addInput(createInputCentered<LunettaModulaLogicInputJack>(Vec(STD_COLUMN_POSITIONS[STD_COL3], STD_ROWS5[STD_ROW1]), module, SR1M::DATA_INPUT));
+		addInput(createInputCentered<LunettaModulaLogicInputJack>(Vec(STD_COLUMN_POSITIONS[STD_COL1], STD_ROWS5[STD_ROW3]), module, SR1M::LOOP_INPUT));
+
+		// length knob and CV
+		addParam(createParamCentered<Potentiometer<RedKnob>>(Vec(STD_COLUMN_POSITIONS[STD_COL2], STD_ROWS5[STD_ROW2]), module, SR1M::LENGTH_PARAM));
+		addInput(createInputCentered<LunettaModulaAnalogInputJack>(Vec(STD_COLUMN_POSITIONS[STD_COL3], STD_ROWS5[STD_ROW3]), module, SR1M::LENGTH_INPUT));
+
+		// tap outputs
+		for (int t = 0; t < SR1M_NUM_TAPS; t++) {
+			int col = (t & 1) ? STD_COL3 : STD_COL1;
+			int row = STD_ROW4 + (t >> 1);
+			addOutput(createOutputCentered<LunettaModulaLogicOutputJack>(Vec(STD_COLUMN_POSITIONS[col], STD_ROWS5[row]), module, SR1M::TAP_OUTPUTS + t));
+			addChild(createLightCentered<SmallLight<RedLight>>(Vec(STD_COLUMN_POSITIONS[col] + 12, STD_ROWS5[row] - 19), module, SR1M::TAP_LIGHTS + t));
+		}
+	}
+
+	// include the I/O mode menu item struct we'll need when we add the theme menu items
+	#include "../modes/modeMenuItem.hpp"
+
+	void appendContextMenu(Menu *menu) override {
+		SR1M *module = dynamic_cast<SR1M*>(this->module);
+		assert(module);
+
+		// blank separator
+		menu->addChild(new MenuSeparator());
+
+		// add the I/O mode menu items
+		#include "../modes/modeMenus.hpp"
+	}
+};
+
+Model *modelSR1M = createModel<SR1M, SR1MWidget>("SR1M");
@@ -6,9 +6,13 @@
 #include "../LunettaModula.hpp"
 #include "../inc/Utility.hpp"
 #include "../inc/CMOSInput.hpp"
+#include "../inc/TruthTableFile.hpp"
 
 // used by mode management includes
 #define MODULE_NAME Truth2
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
 
 #define NUM_STATES 4
 
@@ -76,8 +80,8 @@ struct Truth2 : Module {
 	void setIOMode (int mode) {
 		
 		// set CMOS input properties
-		aInput.setMode(mode);
-		bInput.setMode(mode);
+		aInput.setThresholds(&thresholds);
+		bInput.setThresholds(&thresholds);
 		
 		// set gate voltage
 		#include "../modes/setGateVoltage.hpp"
@@ -105,7 +109,34 @@ struct Truth2 : Module {
 		processCount = 8;
 	}	
 
+	void getTruthTable(TruthTable &table) {
+		table.numInputs = 2;
+		table.numOutputs = 1;
+		table.clear();
+
+		for (int g = 0; g < NUM_STATES; g++)
+			table.set(g, 0, params[STATE_PARAMS + g].getValue() > 0.5f);
+	}
+
+	// only the first output of the table is used, and it must have the same number of inputs as we do
+	bool setTruthTable(const TruthTable &table, std::string &error) {
+		if (table.numInputs != 2) {
+			error = rack::string::f("The table has %d inputs, Truth2 needs 2", table.numInputs);
+			return false;
+		}
+
+		for (int g = 0; g < NUM_STATES; g++)
+			params[STATE_PARAMS + g].setValue(table.get(g, 0) ? 1.0f : 0.0f);
+
+		return true;
+	}
+
 	void process(const ProcessArgs &args) override {
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
+
+	void processLogic(const ProcessArgs &args) {
 
 		// process inputs
 		int q = 0;
@@ -181,6 +212,12 @@ struct Truth2Widget : ModuleWidget {
 		Truth2 *module = dynamic_cast<Truth2*>(this->module);
 		assert(module);
 
+		// blank separator
+		menu->addChild(new MenuSeparator());
+
+		// table import/export
+		appendTruthTableMenu(menu, module);
+
 		// blank separator
 		menu->addChild(new MenuSeparator());
 		
@@ -0,0 +1,328 @@
+//----------------------------------------------------------------------------
+//	Lunetta Modula Plugin for VCV Rack by Count Modula - TruthN
+//	1 to 8-Bit Logic Truth table with 4 outputs
+//  Copyright (C) 2026  Adam Verspaget
+//----------------------------------------------------------------------------
+#include "../LunettaModula.hpp"
+#include "../inc/Utility.hpp"
+#include "../inc/CMOSInput.hpp"
+#include "../inc/TruthTableFile.hpp"
+
+// used by mode management includes
+#define MODULE_NAME TruthN
+#define OUTPUT_EDGE_MODEL
+#define PROPAGATION_DELAY
+#define CONTROL_RATE
+
+#define MAX_INPUTS 8
+#define MAX_ENTRIES 256
+#define TABLE_WORDS (MAX_ENTRIES / 64)
+#define NUM_TABLES 4
+#define NUM_BUTTONS 16
+#define NUM_PAGES (MAX_ENTRIES / NUM_BUTTONS)
+
+struct TruthN : Module {
+	enum ParamIds {
+		ENUMS(STATE_PARAMS, NUM_BUTTONS),
+		WIDTH_PARAM,
+		PAGE_PARAM,
+		EDIT_PARAM,
+		NUM_PARAMS
+	};
+	enum InputIds {
+		ENUMS(LOGIC_INPUTS, MAX_INPUTS),
+		NUM_INPUTS
+	};
+	enum OutputIds {
+		ENUMS(Q_OUTPUTS, NUM_TABLES),
+		NUM_OUTPUTS
+	};
+	enum LightIds {
+		ENUMS(Q_LIGHTS, NUM_TABLES),
+		ENUMS(STATE_PARAM_LIGHTS, NUM_BUTTONS),
+		ENUMS(CURRENT_STATE_LIGHTS, NUM_BUTTONS),
+		NUM_LIGHTS
+	};
+
+	// add the variables we'll use when managing modes
+	#include "../modes/modeVariables.hpp"
+
+	int processCount = 8;
+
+	// one bit per entry for each output, entry 0 being bit 0 of the first word
+	uint64_t tables[NUM_TABLES][TABLE_WORDS] = {};
+
+	// state of each input for each group of 4 channels as SIMD masks
+	simd::float_4 inputStates[MAX_INPUTS][PORT_MAX_CHANNELS / 4];
+
+	bool prevButtons[NUM_BUTTONS] = {};
+
+	// the entry selected on the first channel, shown on the state lights
+	int currentEntry = 0;
+
+	TruthN() {
+		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+
+		for (int b = 0; b < NUM_BUTTONS; b++)
+			configButton(STATE_PARAMS + b, rack::string::f("State %d", b + 1));
+
+		configParam(WIDTH_PARAM, 1.0f, (float)MAX_INPUTS, 3.0f, "Inputs");
+		paramQuantities[WIDTH_PARAM]->snapEnabled = true;
+
+		std::vector<std::string> pageLabels;
+		for (int p = 0; p < NUM_PAGES; p++)
+			pageLabels.push_back(rack::string::f("States %d to %d", p * NUM_BUTTONS + 1, (p + 1) * NUM_BUTTONS));
+
+		configSwitch(PAGE_PARAM, 0.0f, (float)(NUM_PAGES - 1), 0.0f, "Page", pageLabels);
+		configSwitch(EDIT_PARAM, 0.0f, (float)(NUM_TABLES - 1), 0.0f, "Edit output", {"1", "2", "3", "4"});
+
+		for (int i = 0; i < MAX_INPUTS; i++)
+			configInput(LOGIC_INPUTS + i, rack::string::f("%c", 'A' + i));
+
+		inputInfos[LOGIC_INPUTS]->description = "Most significant bit";
+
+		for (int t = 0; t < NUM_TABLES; t++)
+			configOutput(Q_OUTPUTS + t, rack::string::f("Q%d", t + 1));
+
+		for (int i = 0; i < MAX_INPUTS; i++) {
+			for (int g = 0; g < PORT_MAX_CHANNELS / 4; g++)
+				inputStates[i][g] = simd::float_4::zero();
+		}
+
+		setIOMode(VCVRACK_STANDARD);
+	}
+
+	void onReset() override {
+		for (int i = 0; i < MAX_INPUTS; i++) {
+			for (int g = 0; g < PORT_MAX_CHANNELS / 4; g++)
+				inputStates[i][g] = simd::float_4::zero();
+		}
+
+		for (int t = 0; t < NUM_TABLES; t++) {
+			for (int w = 0; w < TABLE_WORDS; w++)
+				tables[t][w] = 0;
+		}
+
+		processCount = 8;
+	}
+
+	void setIOMode (int mode) {
+		// the inputs are modelled in the logic using the module's thresholds
+
+		// set gate voltage
+		#include "../modes/setGateVoltage.hpp"
+	}
+
+	json_t *dataToJson() override {
+		json_t *root = json_object();
+		json_object_set_new(root, "moduleVersion", json_integer(1));
+
+		// each table is saved as a string of hex digits, one word at a time starting with the first
+		json_t *t = json_array();
+		for (int i = 0; i < NUM_TABLES; i++) {
+			std::string s;
+			for (int w = 0; w < TABLE_WORDS; w++)
+				s += rack::string::f("%016llx", (unsigned long long)tables[i][w]);
+
+			json_array_append_new(t, json_string(s.c_str()));
+		}
+
+		json_object_set_new(root, "tables", t);
+
+		// add the I/O mode details
+		#include "../modes/dataToJson.hpp"
+
+		return root;
+	}
+
+	void dataFromJson(json_t *root) override {
+
+		json_t *t = json_object_get(root, "tables");
+		if (t) {
+			for (int i = 0; i < NUM_TABLES; i++) {
+				json_t *table = json_array_get(t, i);
+				if (!table)
+					break;
+
+				// leave any table that hasn't been saved as a string as it is
+				if (!json_is_string(table))
+					continue;
+
+				std::string s = json_string_value(table);
+				for (int w = 0; w < TABLE_WORDS && (int)s.size() >= (w + 1) * 16; w++)
+					tables[i][w] = std::strtoull(s.substr(w * 16, 16).c_str(), NULL, 16);
+			}
+		}
+
+		// grab the I/O mode details
+		#include "../modes/dataFromJson.hpp"
+
+		processCount = 8;
+	}
+
+	void process(const ProcessArgs &args) override {
+		// run the logic and model the outputs
+		#include "../modes/processWrapper.hpp"
+	}
+
+	inline float tableBit(const uint64_t *table, int entry) {
+		return (float)((table[entry >> 6] >> (entry & 63)) & 1);
+	}
+
+	void getTruthTable(TruthTable &table) {
+		table.numInputs = (int)params[WIDTH_PARAM].getValue();
+		table.numOutputs = NUM_TABLES;
+		table.clear();
+
+		for (int e = 0; e < table.numEntries(); e++) {
+			for (int t = 0; t < NUM_TABLES; t++)
+				table.set(e, t, tableBit(tables[t], e) > 0.5f);
+		}
+	}
+
+	// the number of inputs follows the table, outputs beyond the 4th are dropped
+	bool setTruthTable(const TruthTable &table, std::string &error) {
+		params[WIDTH_PARAM].setValue((float)table.numInputs);
+
+		for (int t = 0; t < NUM_TABLES; t++) {
+			for (int w = 0; w < TABLE_WORDS; w++)
+				tables[t][w] = 0;
+
+			for (int e = 0; t < table.numOutputs && e < table.numEntries(); e++) {
+				if (table.get(e, t))
+					tables[t][e >> 6] |= (uint64_t)1 << (e & 63);
+			}
+		}
+
+		processCount = 8;
+		return true;
+	}
+
+	void processLogic(const ProcessArgs &args) {
+
+		int width = (int)params[WIDTH_PARAM].getValue();
+
+		int channels = 1;
+		for (int i = 0; i < width; i++)
+			channels = std::max(channels, inputs[LOGIC_INPUTS + i].getChannels());
+
+		simd::float_4 vLow = thresholds.vLow;
+		simd::float_4 vHigh = thresholds.vHigh;
+
+		// 4 channels at a time - find the entry for each channel, input A being the most significant bit
+		for (int c = 0; c < channels; c += 4) {
+			int g = c >> 2;
+
+			simd::float_4 entry = simd::float_4::zero();
+			for (int i = 0; i < width; i++) {
+				simd::float_4 v = inputs[LOGIC_INPUTS + i].getPolyVoltageSimd<simd::float_4>(c);
+				inputStates[i][g] = simd::ifelse(inputStates[i][g], v > vLow, v >= vHigh);
+				entry = entry + entry + simd::ifelse(inputStates[i][g], simd::float_4(1.0f), simd::float_4::zero());
+			}
+
+			int e0 = (int)entry[0];
+			int e1 = (int)entry[1];
+			int e2 = (int)entry[2];
+			int e3 = (int)entry[3];
+
+			// and look each one up in every table
+			for (int t = 0; t < NUM_TABLES; t++) {
+				const uint64_t *table = tables[t];
+				simd::float_4 q = simd::float_4(tableBit(table, e0), tableBit(table, e1), tableBit(table, e2), tableBit(table, e3));
+				outputs[Q_OUTPUTS + t].setVoltageSimd(q * gateVoltage, c);
+			}
+
+			if (c == 0)
+				currentEntry = e0;
+		}
+
+		for (int t = 0; t < NUM_TABLES; t++)
+			outputs[Q_OUTPUTS + t].setChannels(channels);
+
+		// process buttons and state lights - no need to do this at audio rates
+		if (++processCount > 8) {
+			processCount = 0;
+
+			int entries = 1 << width;
+			int page = std::min((int)params[PAGE_PARAM].getValue(), std::max(entries / NUM_BUTTONS, 1) - 1);
+			int edit = (int)params[EDIT_PARAM].getValue();
+
+			for (int b = 0; b < NUM_BUTTONS; b++) {
+				int e = page * NUM_BUTTONS + b;
+
+				// the table is only touched when a button is pressed
+				bool pressed = params[STATE_PARAMS + b].getValue() > 0.5f;
+				if (pressed && !prevButtons[b] && e < entries)
+					tables[edit][e >> 6] ^= (uint64_t)1 << (e & 63);
+
+				prevButtons[b] = pressed;
+
+				lights[STATE_PARAM_LIGHTS + b].setBrightness(e < entries ? tableBit(tables[edit], e) : 0.0f);
+				lights[CURRENT_STATE_LIGHTS + b].setBrightness(boolToLight(e == currentEntry));
+			}
+
+			for (int t = 0; t < NUM_TABLES; t++)
+				lights[Q_LIGHTS + t].setBrightness(tableBit(tables[t], currentEntry));
+		}
+	}
+};
+
+struct TruthNWidget : ModuleWidget {
+	TruthNWidget(TruthN *module) {
+		setModule(module);
+		setPanel(APP->window->loadSvg(asset::plugin(pluginInstance, "res/TruthN.svg")));
+
+		// screws
+		#include "../components/stdScrews.hpp"
+
+		// inputs
+		for (int i = 0; i < MAX_INPUTS; i++)
+			addInput(createInputCentered<LunettaModulaLogicInputJack>(Vec(STD_COLUMN_POSITIONS[STD_COL1], STD_ROWS8[STD_ROW1 + i]), module, TruthN::LOGIC_INPUTS + i));
+
+		// buttons and state lights
+		for (int b = 0; b < NUM_BUTTONS; b++) {
+			float x = 72.0f + 26.0f * (b & 3);
+			float y = 64.0f + 32.0f * (b >> 2);
+			addParam(createParamCentered<LunettaModulaLEDPushButtonMiniMomentary<LunettaModulaPBLight<RedLight>>>(Vec(x, y), module, TruthN::STATE_PARAMS + b, TruthN::STATE_PARAM_LIGHTS + b));
+			addChild(createLightCentered<SmallLight<RedLight>>(Vec(x, y + 13), module, TruthN::CURRENT_STATE_LIGHTS + b));
+		}
+
+		// page and edit selection
+		addParam(createParamCentered<RotarySwitch<RedKnob>>(Vec(STD_COLUMN_POSITIONS[STD_COL3], STD_ROWS8[STD_ROW5] + 21), module, TruthN::PAGE_PARAM));
+		addParam(createParamCentered<RotarySwitch<RedKnob>>(Vec(STD_COLUMN_POSITIONS[STD_COL3], STD_ROWS8[STD_ROW7] + 21), module, TruthN::EDIT_PARAM));
+
+		// outputs
+		for (int t = 0; t < NUM_TABLES; t++) {
+			addOutput(createOutputCentered<LunettaModulaLogicOutputJack>(Vec(STD_COLUMN_POSITIONS[STD_COL5], STD_ROWS8[STD_ROW5 + t]), module, TruthN::Q_OUTPUTS + t));
+			addChild(createLightCentered<SmallLight<RedLight>>(Vec(STD_COLUMN_POSITIONS[STD_COL5] + 12, STD_ROWS8[STD_ROW5 + t] - 19), module, TruthN::Q_LIGHTS + t));
+		}
+	}
+
+	// include the I/O mode menu item struct we'll need when we add the theme menu items
+	#include "../modes/modeMenuItem.hpp"
+
+	void appendContextMenu(Menu *menu) override {
+		TruthN *module = dynamic_cast<TruthN*>(this->module);
+		assert(module);
+
+		// blank separator
+		menu->addChild(new MenuSeparator());
+
+		// the number of inputs is a set and forget option so it lives here
+		ui::Slider *widthSlider = new ui::Slider;
+		widthSlider->quantity = module->paramQuantities[TruthN::WIDTH_PARAM];
+		widthSlider->box.size.x = 200.0f;
+		menu->addChild(widthSlider);
+
+		// table import/export
+		appendTruthTableMenu(menu, module);
+
+		// blank separator
+		menu->addChild(new MenuSeparator());
+
+		// add the I/O mode menu items
+		#include "../modes/modeMenus.hpp"
+	}
+};
+
+Model *modelTruthN = createModel<TruthN, TruthNWidget>("TruthN");